@@ -22,13 +22,26 @@
 #ifndef __DELAUNAY_MESHER_H_INCLUDED__
 #define __DELAUNAY_MESHER_H_INCLUDED__
 
+#include "Mesh_hierarchy.h"
+#include "Sizing.h"
+#include "Thread_pool.h"
 #include "Triangulation.h"
 #include "Utils.h"
 
+#include <boost/bind/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered/unordered_map.hpp>
 #include <boost/unordered/unordered_set.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
 #include <set>
 #include <stack>
+#include <vector>
 
 namespace umeshu {
 
@@ -70,7 +83,7 @@ public:
                 } else if (min_angle() > q.min_angle()) {
                     return false;
                 } else { // areas and min angles are equal
-                    return &(*(face())) < &(*(q.face()));
+                    return has_smaller_vertices(face(), q.face());
                 }
             }
         }
@@ -78,6 +91,22 @@ public:
     }
 
 private:
+    // Ties are broken by the positions of the vertices, not by the addresses
+    // of the faces, so that the order of the refinement does not depend on
+    // where the faces lie in memory.
+    static bool has_smaller_vertices(Face_handle f, Face_handle g) {
+        Point2 pf[3], pg[3];
+        f->vertices(pf[0], pf[1], pf[2]);
+        g->vertices(pg[0], pg[1], pg[2]);
+        std::sort(pf, pf + 3, is_lexicographically_smaller);
+        std::sort(pg, pg + 3, is_lexicographically_smaller);
+        return std::lexicographical_compare(pf, pf + 3, pg, pg + 3, is_lexicographically_smaller);
+    }
+
+    static bool is_lexicographically_smaller(Point2 const& p, Point2 const& q) {
+        return p.x() < q.x() || (p.x() == q.x() && p.y() < q.y());
+    }
+
     Face_handle face_;
     double area_;
     double min_angle_;
@@ -114,85 +143,621 @@ public:
         }
     };
 
-    typedef boost::unordered_set<Halfedge_handle, Halfedge_handle_hash> Encroached_halfedges;
+    struct Node_handle_hash {
+        size_t operator()(Node_handle const& n) const
+        {
+            return boost::hash<Node*>()(&(*n));
+        }
+    };
+
+    // Halfedges queued at most once each and split in the order in which
+    // they were found, so that the order does not depend on where they lie
+    // in memory
+    class Encroached_halfedges {
+    public:
+        bool empty() const { return queue_.empty(); }
+        std::size_t size() const { return queue_.size(); }
+
+        void insert(Halfedge_handle he) {
+            if (queued_.insert(he).second) {
+                queue_.push_back(he);
+            }
+        }
+
+        Halfedge_handle pop() {
+            Halfedge_handle he = queue_.front();
+            queue_.pop_front();
+            queued_.erase(he);
+            return he;
+        }
+
+        void clear() {
+            queue_.clear();
+            queued_.clear();
+        }
+
+    private:
+        std::deque<Halfedge_handle> queue_;
+        boost::unordered_set<Halfedge_handle, Halfedge_handle_hash> queued_;
+    };
+
     typedef std::set<Quality> Bad_faces;
-    typedef std::stack<Edge_handle> Undo_stack;
+    typedef std::vector<Face_handle> Faces;
+    typedef std::vector<Halfedge_handle> Halfedges;
+    typedef boost::function<double (Point2 const&)> Size_function;
+    typedef boost::unordered_map<Face const*, double> Size_multipliers;
+
+    // Limits on the refinement, zero meaning no limit. The refinement stops
+    // after the insertions in progress when it reaches one of them, leaving
+    // a constrained Delaunay triangulation with some bad faces. The limits
+    // are checked also between the splits of encroached boundary edges, so
+    // the triangulation need not be conforming if they stop the refinement
+    // during the initial splitting of the boundary.
+    // The time is counted from the call of refine, refine_to_count,
+    // refine_levels or adapt and the memory taken by the mesh is estimated
+    // from the numbers of its items.
+    struct Limits {
+        Limits () : seconds(0.0), num_nodes(0), num_bytes(0) {}
+
+        double      seconds;
+        std::size_t num_nodes;
+        std::size_t num_bytes;
+    };
+
+    enum Limit { NO_LIMIT, TIME_LIMIT, NODE_LIMIT, MEMORY_LIMIT };
+
+    // The faces left bad by the last refinement, counted as too large and as
+    // too skinny (a face can be both), the boundary edges left encroached
+    // upon and the limit which stopped it.
+    struct Report {
+        Report () : limit(NO_LIMIT), num_bad_faces(0), num_large_faces(0), num_skinny_faces(0), num_encroached_edges(0) {}
+
+        Limit       limit;
+        std::size_t num_bad_faces;
+        std::size_t num_large_faces;
+        std::size_t num_skinny_faces;
+        std::size_t num_encroached_edges;
+    };
 
     explicit Delaunay_mesher ()
         : mesh_(NULL)
+        , resumable_(false)
         , max_area_(1.0)
         , min_angle_(utils::degrees_to_radians(20.0))
+        , num_threads_(1)
+        , face_limit_(0)
     {}
 
+    // Experimental. With more than one thread, the mesher works in rounds:
+    // the cavities of the circumcenters of the worst bad faces are computed
+    // concurrently on the unchanged mesh, then those that do not share any
+    // node are inserted one after another by the calling thread. Only the
+    // cavity search runs in parallel and about a fifth of the cavities are
+    // discarded, so the speedup is small even on many cores, and on one
+    // core the refinement is slower than with a single thread. The worker
+    // threads are started once for the whole refinement.
+    void set_num_threads (unsigned num_threads) {
+        num_threads_ = std::max(num_threads, 1u);
+    }
+
+    unsigned num_threads () const { return num_threads_; }
+
+    void set_limits (Limits const& limits) { limits_ = limits; }
+
+    Limits const& limits () const { return limits_; }
+
+    Report const& report () const { return report_; }
+
     void refine (Delaunay_triangulation& mesh, double max_area, double min_angle) {
+        refine(mesh, max_area, min_angle, Size_function());
+    }
+
+    // The size function gives the desired edge length at a point. A face is
+    // refined also if it is larger than the equilateral triangle with edges
+    // of the desired length at its barycenter.
+    void refine (Delaunay_triangulation& mesh, double max_area, double min_angle, Size_function const& size) {
+        start_clock();
+        refine_within_limits(mesh, max_area, min_angle, size, false);
+    }
+
+    // Refines the mesh refined last again with new bounds. No boundary edge
+    // is encroached upon after the last refinement, so only the faces are
+    // checked against the new bounds. The mesh must not have been changed in
+    // between (e.g., relaxed or smoothed), since that can leave it not
+    // Delaunay or with encroached edges; refine() has to be called then.
+    void resume (double max_area, double min_angle, Size_function const& size = Size_function()) {
+        BOOST_ASSERT(is_resumable());
+        start_clock();
+        refine_within_limits(*mesh_, max_area, min_angle, size, true);
+    }
+
+    bool is_resumable () const { return resumable_; }
+
+    // Refines a mesh in which only the given faces can be bad or have a
+    // boundary edge encroached upon by their third node, e.g., a refined
+    // mesh changed locally. Neither the whole boundary nor all faces are
+    // checked, so the cost depends on the size of the changed region and
+    // of the refinement it needs, not on the size of the mesh.
+    void refine_faces (Delaunay_triangulation& mesh, Faces const& faces, double max_area, double min_angle, Size_function const& size = Size_function()) {
+        start_clock();
+        begin_local_refinement(mesh, faces, max_area, min_angle, size);
+        step(std::numeric_limits<std::size_t>::max());
+        finish();
+    }
+
+    // Stepwise refinement for callers that need control between the steps,
+    // e.g. to draw the mesh or to cancel. begin() starts the refinement as
+    // refine() would, step() inserts at least the given number of nodes
+    // unless no bad face is left or a limit is reached, and returns whether
+    // it can continue. finish() ends the refinement at any point and fills
+    // the report. Between the steps the mesh is a conforming constrained
+    // Delaunay triangulation, unless a limit has stopped the splitting of
+    // encroached boundary edges.
+    void begin (Delaunay_triangulation& mesh, double max_area, double min_angle, Size_function const& size = Size_function()) {
+        start_clock();
+        begin_refinement(mesh, max_area, min_angle, size, false);
+    }
+
+    bool step (std::size_t num_insertions) {
+        std::size_t num_nodes = mesh_->number_of_nodes();
+        while ((!bad_faces_.empty() || !enc_hedges_.empty()) && mesh_->number_of_nodes() - num_nodes < num_insertions) {
+            if (face_limit_ > 0 && mesh_->number_of_faces() >= face_limit_) {
+                return false;
+            }
+            report_.limit = limit_reached();
+            if (report_.limit != NO_LIMIT) {
+                return false;
+            }
+            if (!enc_hedges_.empty()) {
+                split_encroached_boundary_edges(true);
+                continue;
+            }
+            if (!pool_ || kill_bad_faces_in_parallel() == 0) {
+                kill_bad_face(bad_faces_.begin()->face());
+            }
+        }
+        return !bad_faces_.empty() || !enc_hedges_.empty();
+    }
+
+    // Every insertion is complete when a step returns, so the refinement can
+    // be resumed even if it has been finished early.
+    void finish () {
+        for (typename Bad_faces::const_iterator iter = bad_faces_.begin(); iter != bad_faces_.end(); ++iter) {
+            if (is_too_large(*iter)) {
+                ++report_.num_large_faces;
+            }
+            if (iter->min_angle() < min_angle_) {
+                ++report_.num_skinny_faces;
+            }
+        }
+        report_.num_bad_faces = bad_faces_.size();
+        report_.num_encroached_edges = enc_hedges_.size();
+        bad_faces_.clear();
+        enc_hedges_.clear();
+        face_sizes_.clear();
+        pool_.reset();
+        resumable_ = report_.num_encroached_edges == 0;
+    }
+
+    // Refines the mesh to about the given number of faces and returns the
+    // area bound the faces satisfy. The first bound is four times the average
+    // face area, then the bound is scaled by the ratio of the current and the
+    // target number of faces, each step resuming the refinement of the
+    // previous one. The number of faces does not follow the bound smoothly,
+    // so a step reaching the target is stopped there and the faces still
+    // violating the angle bound are refined with the bound of the step before.
+    double refine_to_count (Delaunay_triangulation& mesh, std::size_t num_faces, double min_angle) {
+        BOOST_ASSERT(num_faces > 0);
+        double domain_area = 0.0;
+        for (Face_iterator iter = mesh.faces_begin(); iter != mesh.faces_end(); ++iter) {
+            Point2 p1, p2, p3;
+            iter->vertices(p1, p2, p3);
+            domain_area += Kernel::signed_area(p1, p2, p3);
+        }
+
+        start_clock();
+        double const target = static_cast<double>(num_faces);
+        double max_area = 4.0 * domain_area / target;
+        refine_within_limits(mesh, max_area, min_angle, Size_function(), false);
+        for (int step = 1; step < 20 && mesh.number_of_faces() < 0.98 * target; ++step) {
+            if (report_.limit != NO_LIMIT) {
+                break;
+            }
+            std::size_t previous = mesh.number_of_faces();
+            double previous_area = max_area;
+            max_area *= std::max(previous / target, 0.25);
+            face_limit_ = num_faces;
+            refine_within_limits(mesh, max_area, min_angle, Size_function(), true);
+            face_limit_ = 0;
+            if (mesh.number_of_faces() >= num_faces && report_.limit == NO_LIMIT) {
+                refine_within_limits(mesh, previous_area, min_angle, Size_function(), true);
+                return previous_area;
+            }
+            if (mesh.number_of_faces() == previous) {
+                break;
+            }
+        }
+        return max_area;
+    }
+
+    // Refines the mesh in place with the area bound divided by four at each
+    // level, recording the levels for use in multigrid methods. The level
+    // during which a limit is reached is the last one.
+    void refine_levels (Delaunay_triangulation& mesh, double max_area, double min_angle, unsigned num_levels, Mesh_hierarchy<Tria>& hierarchy) {
+        start_clock();
+        hierarchy.clear();
+        for (unsigned level = 0; level < num_levels; ++level, max_area *= 0.25) {
+            refine_within_limits(mesh, max_area, min_angle, Size_function(), level > 0);
+            hierarchy.add_level(mesh);
+            if (report_.limit != NO_LIMIT) {
+                break;
+            }
+        }
+    }
+
+    // Adapts the mesh to sizes given relative to the current ones: the size
+    // (edge length) of a face is to be multiplied by its multiplier, the
+    // faces without one keep their size. Where the size grows, the removable
+    // nodes all of whose faces grow are removed while a neighbour is closer
+    // than 1/sqrt(2) times the new size. Then the faces around the nodes of
+    // those with a multiplier and around the neighbours of the removed nodes
+    // are refined if larger than the equilateral triangle of the new size or
+    // with an angle smaller than min_angle. The rest of the mesh is not
+    // visited, so the cost depends on the size of the changed region. The
+    // nodes that are kept keep their handles and the new ones are added at
+    // the end of the node list.
+    void adapt (Delaunay_triangulation& mesh, Size_multipliers const& multipliers, double min_angle) {
+        start_clock();
+        resumable_ = false;
+
+        Triangle_size<Kernel> size;
+        Removals removals;
+        Node_set visited, region;
+        for (typename Size_multipliers::const_iterator iter = multipliers.begin(); iter != multipliers.end(); ++iter) {
+            double m = iter->second;
+            if (m == 1.0) {
+                continue;
+            }
+            BOOST_ASSERT(m > 0.0);
+            Face_handle f = iter->first->halfedge()->face();
+            Point2 p1, p2, p3;
+            f->vertices(p1, p2, p3);
+            size.add_triangle(p1, p2, p3, m * equilateral_edge(Kernel::signed_area(p1, p2, p3)));
+            Node_handle n[3];
+            f->nodes(n[0], n[1], n[2]);
+            for (int i = 0; i < 3; ++i) {
+                region.insert(n[i]);
+                if (m > 1.0 && visited.insert(n[i]).second && mesh.is_removable(n[i])) {
+                    double h = coarsened_size(multipliers, n[i]);
+                    if (h > 0.0) {
+                        removals.push_back(std::make_pair(n[i], h));
+                    }
+                }
+            }
+        }
+
+        // Removing a node does not bring the others closer, so every node
+        // needs to be tested only once.
+        for (typename Removals::iterator iter = removals.begin(); iter != removals.end(); ++iter) {
+            Node_handle n = iter->first;
+            if (shortest_edge(n) < std::sqrt(0.5) * iter->second) {
+                Halfedge_handle he = n->halfedge();
+                do {
+                    region.insert(he->pair()->origin());
+                    he = he->pair()->next();
+                } while (he != n->halfedge());
+                region.erase(n);
+                mesh.remove(n);
+            }
+        }
+
+        if (size.number_of_triangles() == 0) {
+            return;
+        }
+
+        Faces faces;
+        boost::unordered_set<Face const*> collected;
+        for (typename Node_set::const_iterator iter = region.begin(); iter != region.end(); ++iter) {
+            Halfedge_handle he = (*iter)->halfedge();
+            do {
+                Face_handle f = he->face();
+                if (f != Face_handle() && collected.insert(&*f).second) {
+                    faces.push_back(f);
+                }
+                he = he->pair()->next();
+            } while (he != (*iter)->halfedge());
+        }
+
+        begin_local_refinement(mesh, faces, std::numeric_limits<double>::max(), min_angle, size);
+        step(std::numeric_limits<std::size_t>::max());
+        finish();
+    }
+
+private:
+    typedef std::vector< std::pair<Node_handle, double> > Removals;
+    typedef boost::unordered_set<Node_handle, Node_handle_hash> Node_set;
+    typedef boost::unordered_map<Face const*, double> Face_sizes;
+
+    static double multiplier (Size_multipliers const& multipliers, Face_handle f) {
+        typename Size_multipliers::const_iterator iter = multipliers.find(&*f);
+        return iter == multipliers.end() ? 1.0 : iter->second;
+    }
+
+    // The edge of the equilateral triangle with the given area
+    static double equilateral_edge (double area) {
+        return std::sqrt(4.0 * area / std::sqrt(3.0));
+    }
+
+    // The smallest new size of the faces around a node, or zero if the size
+    // of some of them does not grow.
+    static double coarsened_size (Size_multipliers const& multipliers, Node_handle n) {
+        double h = std::numeric_limits<double>::max();
+        Halfedge_handle he = n->halfedge();
+        do {
+            Face_handle f = he->face();
+            if (f != Face_handle()) {
+                double m = multiplier(multipliers, f);
+                if (m <= 1.0) {
+                    return 0.0;
+                }
+                Point2 p1, p2, p3;
+                f->vertices(p1, p2, p3);
+                h = std::min(h, m * equilateral_edge(Kernel::signed_area(p1, p2, p3)));
+            }
+            he = he->pair()->next();
+        } while (he != n->halfedge());
+        return h;
+    }
+
+    static double shortest_edge (Node_handle n) {
+        double l = std::numeric_limits<double>::max();
+        Halfedge_handle he = n->halfedge();
+        do {
+            l = std::min(l, he->edge()->length());
+            he = he->pair()->next();
+        } while (he != n->halfedge());
+        return l;
+    }
+
+    void start_clock () {
+        start_time_ = boost::posix_time::microsec_clock::universal_time();
+    }
+
+    void refine_within_limits (Delaunay_triangulation& mesh, double max_area, double min_angle, Size_function const& size, bool resume) {
+        begin_refinement(mesh, max_area, min_angle, size, resume);
+        step(std::numeric_limits<std::size_t>::max());
+        finish();
+    }
+
+    void begin_refinement (Delaunay_triangulation& mesh, double max_area, double min_angle, Size_function const& size, bool resume) {
+        start_refinement(mesh, max_area, min_angle, size);
+
+        if (!resume) {
+            collect_encroached_boundary_edges();
+            split_encroached_boundary_edges(false);
+        }
+        BOOST_ASSERT(enc_hedges_.empty() || report_.limit != NO_LIMIT);
+        BOOST_ASSERT(bad_faces_.empty());
+
+        enqueue_bad_faces();
+    }
+
+    // The faces are all queued before any edge is split, so that those
+    // destroyed by the splits are dequeued.
+    void begin_local_refinement (Delaunay_triangulation& mesh, Faces const& faces, double max_area, double min_angle, Size_function const& size) {
+        start_refinement(mesh, max_area, min_angle, size);
+        BOOST_ASSERT(enc_hedges_.empty());
+        BOOST_ASSERT(bad_faces_.empty());
+
+        for (typename Faces::const_iterator iter = faces.begin(); iter != faces.end(); ++iter) {
+            enqueue_bad_face(*iter);
+            collect_encroached_boundary_edges(*iter);
+        }
+        split_encroached_boundary_edges(true);
+    }
+
+    void start_refinement (Delaunay_triangulation& mesh, double max_area, double min_angle, Size_function const& size) {
+        resumable_ = false;
+
         mesh_ = &mesh;
         max_area_ = max_area;
         min_angle_ = utils::degrees_to_radians(min_angle);
+        size_ = size;
+        face_sizes_.clear();
+        report_ = Report();
 
-        collect_encroached_boundary_edges();
-        split_encroached_boundary_edges(false);
-        BOOST_ASSERT(bad_faces_.empty());
+        if (num_threads_ > 1 && (!pool_ || pool_->size() != num_threads_)) {
+            pool_.reset(new Thread_pool(num_threads_));
+        }
+    }
 
-        for (Face_iterator iter = mesh_->faces_begin(); iter != mesh_->faces_end(); ++iter) {
-            enqueue_bad_face(iter);
+    Limit limit_reached () const {
+        if (limits_.num_nodes > 0 && mesh_->number_of_nodes() >= limits_.num_nodes) {
+            return NODE_LIMIT;
         }
+        if (limits_.num_bytes > 0 && mesh_bytes() >= limits_.num_bytes) {
+            return MEMORY_LIMIT;
+        }
+        if (limits_.seconds > 0.0) {
+            boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start_time_;
+            if (elapsed.total_microseconds() >= 1e6 * limits_.seconds) {
+                return TIME_LIMIT;
+            }
+        }
+        return NO_LIMIT;
+    }
 
-        while (!bad_faces_.empty()) {
-            Face_handle bad_face = bad_faces_.begin()->face();
+    // Every item of the mesh is kept in a list node with two links.
+    std::size_t mesh_bytes () const {
+        std::size_t const links = 2 * sizeof(void*);
+        return mesh_->number_of_nodes() * (sizeof(Node) + links)
+             + mesh_->number_of_halfedges() * (sizeof(Halfedge) + links)
+             + mesh_->number_of_edges() * (sizeof(Edge) + links)
+             + mesh_->number_of_faces() * (sizeof(Face) + links);
+    }
+
+    struct Insertion {
+        Node_handle n1, n2, n3;
+        Point2    center;
+        bool      clean;
+        Faces     faces;
+        Halfedges boundary;
+        std::vector<Node_handle> nodes;
+    };
 
-            Node_handle n1, n2, n3;
-            bad_face->nodes(n1, n2, n3);
+    void kill_bad_face (Face_handle bad_face) {
+        Node_handle n1, n2, n3;
+        bad_face->nodes(n1, n2, n3);
 
-            Point2 center = Kernel::circumcenter( n1->position(), n2->position(), n3->position() );
+        Point2 center = Kernel::snap( Kernel::circumcenter( n1->position(), n2->position(), n3->position() ) );
 
-            Point_location loc;
-            Face_handle face_to_kill;
-            Edge_handle edge_to_kill;
-            Node_handle node_to_kill;
-            face_to_kill = mesh_->locate(center, loc, node_to_kill, edge_to_kill, bad_face);
-            BOOST_ASSERT(loc != ON_NODE);
+        Point_location loc;
+        Face_handle face_to_kill;
+        Edge_handle edge_to_kill;
+        Node_handle node_to_kill;
+        face_to_kill = mesh_->locate(center, loc, node_to_kill, edge_to_kill, bad_face);
+        BOOST_ASSERT(loc != ON_NODE);
 
+        if (loc == IN_FACE || loc == ON_EDGE) {
+            if (loc == ON_EDGE) {
+                face_to_kill = edge_to_kill->he1()->is_boundary() ? edge_to_kill->he2()->face() : edge_to_kill->he1()->face();
+            }
+            mesh_->get_cavity(center, face_to_kill, cavity_faces_, cavity_boundary_);
             std::stack<Halfedge_handle> E;
-            if (loc == IN_FACE) {
-                Node_handle new_node = try_kill_face(face_to_kill, center, E);
-                if (E.empty()) {
-                    clear_undo_stack();
-                    treat_new_node(new_node, true);
-                } else {
-                    undo_kill_face(new_node);
-                    bad_face = get_original_bad_face(n1, n2, n3);
-                    BOOST_ASSERT(bad_face != Face_handle());
-                    finish_dealing_with_bad_face(bad_face, E);
-                }
-            } else if (loc == ON_EDGE) {
-                bool build_123 = !edge_to_kill->he1()->is_boundary();
-                bool build_142 = !edge_to_kill->he2()->is_boundary();
-                Node_handle n1_ = edge_to_kill->he1()->origin();
-                Node_handle n2_ = edge_to_kill->he2()->origin();
-                Node_handle new_node = try_kill_edge(edge_to_kill, center, E);
-                if (E.empty()) {
-                    clear_undo_stack();
-                    treat_new_node(new_node, true);
-                } else {
-                    undo_kill_edge(new_node, n1_, n2_, build_123, build_142);
-                    bad_face = get_original_bad_face(n1, n2, n3);
-                    BOOST_ASSERT(bad_face != Face_handle());
-                    finish_dealing_with_bad_face(bad_face, E);
-                }
-            } else { // loc == OUTSIDE_MESH:
-                Edge_handle e = edge_to_kill;
-                BOOST_ASSERT(e->is_boundary());
-                if (e->he1()->is_boundary()) {
-                    enc_hedges_.insert(e->he1());
-                } else {
-                    enc_hedges_.insert(e->he2());
+            collect_encroached_boundary_edges(center, E);
+            if (E.empty()) {
+                Node_handle new_node = insert_in_cavity(center);
+                treat_new_node(new_node, true);
+            } else {
+                finish_dealing_with_bad_face(bad_face, E);
+            }
+        } else { // loc == OUTSIDE_MESH:
+            Edge_handle e = edge_to_kill;
+            BOOST_ASSERT(e->is_boundary());
+            if (e->he1()->is_boundary()) {
+                enc_hedges_.insert(e->he1());
+            } else {
+                enc_hedges_.insert(e->he2());
+            }
+            split_encroached_boundary_edges(true);
+        }
+    }
+
+    std::size_t kill_bad_faces_in_parallel () {
+        std::size_t n = std::min<std::size_t>(bad_faces_.size(), 64 * pool_->size());
+        if (n < pool_->size()) {
+            return 0;
+        }
+
+        batch_.clear();
+        for (typename Bad_faces::iterator iter = bad_faces_.begin(); batch_.size() < n; ++iter) {
+            batch_.push_back(iter->face());
+        }
+        insertions_.resize(n);
+
+        pool_->run(boost::bind(&Delaunay_mesher::prepare_insertions, this, boost::placeholders::_1));
+
+        // Claiming also the nodes across the cavity boundary guarantees that
+        // the cavities and their neighbourhoods stay untouched by the other
+        // insertions of this round.
+        std::size_t inserted = 0;
+        claimed_nodes_.clear();
+        for (std::size_t i = 0; i < n; ++i) {
+            Insertion& ins = insertions_[i];
+            if (!ins.clean || !claim_nodes(ins.nodes)) {
+                continue;
+            }
+            cavity_faces_.swap(ins.faces);
+            cavity_boundary_.swap(ins.boundary);
+            Node_handle new_node = insert_in_cavity(ins.center);
+            treat_new_node(new_node, true);
+            ++inserted;
+        }
+
+        // Bad faces whose circumcenters encroach upon the boundary are dealt
+        // with sequentially. Nodes are never removed, so we can find out
+        // whether such a face survived the previous insertions.
+        for (std::size_t i = 0; i < n; ++i) {
+            Insertion& ins = insertions_[i];
+            if (ins.clean) {
+                continue;
+            }
+            Face_handle bad_face = find_face(ins.n1, ins.n2, ins.n3);
+            if (bad_face != Face_handle() && is_enqueued(bad_face)) {
+                kill_bad_face(bad_face);
+                ++inserted;
+            }
+        }
+        return inserted;
+    }
+
+    void prepare_insertions (unsigned thread) {
+        for (std::size_t i = thread; i < batch_.size(); i += pool_->size()) {
+            prepare_insertion(batch_[i], insertions_[i]);
+        }
+    }
+
+    void prepare_insertion (Face_handle bad_face, Insertion& ins) const {
+        ins.clean = false;
+
+        bad_face->nodes(ins.n1, ins.n2, ins.n3);
+        ins.center = Kernel::snap(Kernel::circumcenter(ins.n1->position(), ins.n2->position(), ins.n3->position()));
+
+        Point_location loc;
+        Edge_handle edge;
+        Node_handle node;
+        Face_handle face = mesh_->locate(ins.center, loc, node, edge, bad_face);
+        if (loc == ON_EDGE) {
+            face = edge->he1()->is_boundary() ? edge->he2()->face() : edge->he1()->face();
+        } else if (loc != IN_FACE) {
+            return;
+        }
+
+        mesh_->get_cavity(ins.center, face, ins.faces, ins.boundary);
+        ins.nodes.clear();
+        for (typename Halfedges::iterator iter = ins.boundary.begin(); iter != ins.boundary.end(); ++iter) {
+            Halfedge_handle he = *iter;
+            if (he->edge()->is_boundary() && edge_is_encroached_upon_by_point(he->edge(), ins.center)) {
+                return;
+            }
+            ins.nodes.push_back(he->origin());
+            if (!he->pair()->is_boundary()) {
+                ins.nodes.push_back(he->pair()->prev()->origin());
+            }
+        }
+        ins.clean = true;
+    }
+
+    Face_handle find_face (Node_handle n1, Node_handle n2, Node_handle n3) const {
+        Halfedge_handle he_start = n1->halfedge();
+        Halfedge_handle he_iter = he_start;
+        do {
+            if (he_iter->pair()->origin() == n2) {
+                if (!he_iter->is_boundary() && he_iter->prev()->origin() == n3) {
+                    return he_iter->face();
                 }
-                split_encroached_boundary_edges(true);
+                return Face_handle();
+            }
+            he_iter = he_iter->pair()->next();
+        } while (he_iter != he_start);
+        return Face_handle();
+    }
+
+    bool is_enqueued (Face_handle f) const {
+        return bad_faces_.find(Quality(f)) != bad_faces_.end();
+    }
+
+    bool claim_nodes (std::vector<Node_handle> const& nodes) {
+        typename std::vector<Node_handle>::const_iterator iter;
+        for (iter = nodes.begin(); iter != nodes.end(); ++iter) {
+            if (claimed_nodes_.find(*iter) != claimed_nodes_.end()) {
+                return false;
             }
         }
+        claimed_nodes_.insert(nodes.begin(), nodes.end());
+        return true;
     }
 
-private:
     void collect_encroached_boundary_edges () {
         Halfedge_handle bhe_start = mesh_->boundary_halfedge();
         BOOST_ASSERT(bhe_start != Halfedge_handle());
@@ -207,10 +772,24 @@ private:
         } while (bhe_iter != bhe_start);
     }
 
+    void collect_encroached_boundary_edges (Face_handle f) {
+        Halfedge_handle he = f->halfedge();
+        for (int i = 0; i < 3; ++i, he = he->next()) {
+            if (he->pair()->is_boundary() && edge_is_encroached_upon_by_point(he->edge(), he->prev()->origin()->position())) {
+                enc_hedges_.insert(he);
+            }
+        }
+    }
+
+    // Cascades of splits on small input angles can be long, so the limits
+    // are checked before each split.
     void split_encroached_boundary_edges (bool check_quality) {
         while (!enc_hedges_.empty()) {
-            Halfedge_handle he = *enc_hedges_.begin();
-            enc_hedges_.erase(enc_hedges_.begin());
+            report_.limit = limit_reached();
+            if (report_.limit != NO_LIMIT) {
+                return;
+            }
+            Halfedge_handle he = enc_hedges_.pop();
 
             Halfedge_handle hen = he->next();
             Halfedge_handle hep = he->prev();
@@ -238,7 +817,7 @@ private:
                 split = 0.5;
             }
 
-            Point2 split_point(porig.x()+split*(pdest.x()-porig.x()), porig.y()+split*(pdest.y()-porig.y()));
+            Point2 split_point = Kernel::snap(Point2(porig.x()+split*(pdest.x()-porig.x()), porig.y()+split*(pdest.y()-porig.y())));
             Node_handle new_node;
             if (check_quality) {
                 new_node = split_edge(he->edge(), split_point);
@@ -248,8 +827,8 @@ private:
             Halfedge_handle he1 = hen->prev();
             Halfedge_handle he2 = hep->next();
 
-            recursive_flip_delaunay(hen, check_quality, false);
-            recursive_flip_delaunay(hep, check_quality, false);
+            recursive_flip_delaunay(hen, check_quality);
+            recursive_flip_delaunay(hep, check_quality);
 
             treat_new_node(new_node, check_quality);
 
@@ -275,7 +854,7 @@ private:
         return new_node;
     }
 
-    void recursive_flip_delaunay (Halfedge_handle he, bool check_quality, bool save_to_undo_stack) {
+    void recursive_flip_delaunay (Halfedge_handle he, bool check_quality) {
         if (!he->edge()->is_diagonal_of_convex_quadrilateral() || he->edge()->is_constrained_delaunay()) {
             return;
         }
@@ -289,12 +868,8 @@ private:
             he->edge()->flip();
         }
 
-        if (save_to_undo_stack) {
-            undo_stack_.push(he->edge());
-        }
-
-        this->recursive_flip_delaunay(he1, check_quality, save_to_undo_stack);
-        this->recursive_flip_delaunay(he2, check_quality, save_to_undo_stack);
+        this->recursive_flip_delaunay(he1, check_quality);
+        this->recursive_flip_delaunay(he2, check_quality);
     }
 
     void flip_edge (Edge_handle e) {
@@ -329,99 +904,11 @@ private:
         } while (he_iter != he_start);
     }
 
-    Node_handle try_kill_edge (Edge_handle edge_to_kill, Point2 const& center, std::stack<Halfedge_handle>& E) {
-        Node_handle new_node = split_edge(edge_to_kill, center);
-        Halfedge_handle he_start = new_node->halfedge();
-        Halfedge_handle he_iter  = he_start;
-        do {
-            Halfedge_handle he_next = he_iter->pair()->next();
-            if (!he_iter->is_boundary()) {
-                recursive_flip_delaunay(he_iter->next(), true, true);
-            }
-            he_iter = he_next;
-        } while (he_iter != he_start);
-        collect_encroached_boundary_edges(new_node, E);
-        return new_node;
-    }
-
-    Node_handle try_kill_face(Face_handle face_to_kill, Point2 const& center, std::stack<Halfedge_handle>& E) {
-        Node_handle new_node = split_face(face_to_kill, center);
-        Halfedge_handle  he1 = new_node->halfedge()->next();
-        Halfedge_handle  he2 = he1->next()->pair()->next();
-        Halfedge_handle  he3 = he2->next()->pair()->next();
-        recursive_flip_delaunay(he1, true, true);
-        recursive_flip_delaunay(he2, true, true);
-        recursive_flip_delaunay(he3, true, true);
-        collect_encroached_boundary_edges(new_node, E);
-        return new_node;
-    }
-
-    void undo_kill_face (Node_handle new_node) {
-        undo_swapping();
-        Halfedge_handle he1 = new_node->halfedge()->next();
-        Halfedge_handle he2 = he1->next()->pair()->next();
-        Halfedge_handle he3 = he2->next()->pair()->next();
-        dequeue_bad_face(he1->face());
-        dequeue_bad_face(he2->face());
-        dequeue_bad_face(he3->face());
-        mesh_->remove_node(new_node);
-        Face_handle new_face = mesh_->add_face(he1, he2, he3);
-        enqueue_bad_face(new_face);
-    }
-
-    void undo_kill_edge (Node_handle new_node, Node_handle n1, Node_handle n2, bool build_123, bool build_142) {
-        undo_swapping();
-
-        Halfedge_handle he1, he2;
-        Halfedge_handle he_start = new_node->halfedge();
-        Halfedge_handle he_iter = he_start;
-        do {
-            if (he_iter->pair()->origin() == n1) {
-                he1 = he_iter;
-            }
-            if (he_iter->pair()->origin() == n2) {
-                he2 = he_iter;
-            }
-            he_iter = he_iter->pair()->next();
-        } while (he_iter != he_start);
-
-        Halfedge_handle he23, he31, he14, he42;
-        if (build_123) {
-            he23 = he2->next();
-            he31 = he1->pair()->prev();
-            dequeue_bad_face(he23->face());
-            dequeue_bad_face(he31->face());
-        }
-        if (build_142) {
-            he14 = he1->next();
-            he42 = he2->pair()->prev();
-            dequeue_bad_face(he14->face());
-            dequeue_bad_face(he42->face());
-        }
-        mesh_->remove_node(new_node);
-        Halfedge_handle new_he = mesh_->add_edge(n1, n2);
-        if (build_123) {
-            enqueue_bad_face(mesh_->add_face(new_he, he23, he31));
-        }
-        if (build_142) {
-            enqueue_bad_face(mesh_->add_face(new_he->pair(), he14, he42));
-        }
-    }
-
-    void undo_swapping() {
-        while (!undo_stack_.empty()) {
-            flip_edge(undo_stack_.top());
-            undo_stack_.pop();
+    Node_handle insert_in_cavity(Point2 const& p) {
+        for (typename Faces::iterator iter = cavity_faces_.begin(); iter != cavity_faces_.end(); ++iter) {
+            dequeue_bad_face(*iter);
         }
-    }
-
-    Node_handle split_face(Face_handle f, Point2 const& p) {
-        dequeue_bad_face(f);
-        Node_handle new_node = mesh_->split_face(f, p);
-        enqueue_bad_face(new_node->halfedge()->face());
-        enqueue_bad_face(new_node->halfedge()->pair()->face());
-        enqueue_bad_face(new_node->halfedge()->prev()->pair()->face());
-        return new_node;
+        return mesh_->insert_in_cavity(p, cavity_faces_, cavity_boundary_);
     }
 
     void finish_dealing_with_bad_face(Face_handle bad_face, std::stack<Halfedge_handle> &E) {
@@ -436,7 +923,7 @@ private:
             l2 = Kernel::distance(p2, p3);
             l3 = Kernel::distance(p3, p1);
             double d = std::min(l1, std::min(l2, l3));
-            if (q.area() > max_area_ || split_permitted(he, d)) {
+            if (is_too_large(q) || split_permitted(he, d)) {
                 enc_hedges_.insert(he);
             }
         }
@@ -487,76 +974,147 @@ private:
         return false;
     }
 
-    void collect_encroached_boundary_edges(Node_handle n, std::stack<Halfedge_handle>& E) {
-        Halfedge_handle he_start = n->halfedge();
-        Halfedge_handle he_iter = he_start;
-        do {
-            if (he_iter->face() != Face_handle()) {
-                Edge_handle e = he_iter->next()->edge();
-                if (e->is_boundary() && edge_is_encroached_upon_by_point( e, n->position() )) {
-                    E.push(he_iter->next());
-                }
+    void collect_encroached_boundary_edges(Point2 const& p, std::stack<Halfedge_handle>& E) {
+        for (typename Halfedges::iterator iter = cavity_boundary_.begin(); iter != cavity_boundary_.end(); ++iter) {
+            Edge_handle e = (*iter)->edge();
+            if (e->is_boundary() && edge_is_encroached_upon_by_point( e, p )) {
+                E.push(*iter);
             }
-            he_iter = he_iter->pair()->next();
-        } while (he_iter != he_start);
+        }
     }
 
-    void enqueue_bad_face (Face_handle f) {
-        if (f != Face_handle()) {
-            Quality q(f);
-            unsigned bhe = 0;
-            if (f->halfedge()->pair()->is_boundary()) ++bhe;
-            if (f->halfedge()->next()->pair()->is_boundary()) ++bhe;
-            if (f->halfedge()->prev()->pair()->is_boundary()) ++bhe;
-            bool restricted = bhe > 1;
-            if (q.area() > max_area_ || (q.min_angle() < min_angle_ && !restricted)) {
-                bad_faces_.insert(q);
-            }
+    bool is_too_large (Quality const& q) const {
+        return is_too_large(q, face_size(q.face()));
+    }
+
+    bool is_too_large (Quality const& q, double h) const {
+        return q.area() > max_area_ || q.area() > 0.25 * std::sqrt(3.0) * h * h;
+    }
+
+    // The size function is evaluated once for each face that is queued and
+    // the value is kept until the face is dequeued.
+    double face_size (Face_handle f) const {
+        if (size_.empty()) {
+            return std::numeric_limits<double>::max();
+        }
+        typename Face_sizes::const_iterator iter = face_sizes_.find(&*f);
+        if (iter != face_sizes_.end()) {
+            return iter->second;
         }
+        Point2 p1, p2, p3;
+        f->vertices(p1, p2, p3);
+        return size_(Kernel::barycenter(p1, p2, p3));
     }
 
-    void dequeue_bad_face (Face_handle f)
-    {
-        if (f != Face_handle()) {
-            Quality q(f);
-            unsigned bhe = 0;
-            if (f->halfedge()->pair()->is_boundary()) ++bhe;
-            if (f->halfedge()->next()->pair()->is_boundary()) ++bhe;
-            if (f->halfedge()->prev()->pair()->is_boundary()) ++bhe;
-            bool restricted = bhe > 1;
-            if (q.area() > max_area_ || (q.min_angle() < min_angle_ && !restricted)) {
-                bad_faces_.erase(q);
+    bool is_bad (Quality const& q, double h) const {
+        Face_handle f = q.face();
+        unsigned bhe = 0;
+        if (f->halfedge()->pair()->is_boundary()) ++bhe;
+        if (f->halfedge()->next()->pair()->is_boundary()) ++bhe;
+        if (f->halfedge()->prev()->pair()->is_boundary()) ++bhe;
+        bool restricted = bhe > 1;
+        return is_too_large(q, h) || (q.min_angle() < min_angle_ && !restricted);
+    }
+
+    // The vertices of all faces are gathered first, so that the bounds are
+    // tested by a loop over plain arrays which the compiler can vectorize.
+    // Only the faces it flags, with some slack, are evaluated by Quality.
+    // The angle test uses sin(a) = 2*area / (b*c) for the angle a opposite
+    // to the shortest edge, squared and multiplied out.
+    void enqueue_bad_faces () {
+        std::size_t n = mesh_->number_of_faces();
+        if (n == 0) {
+            return;
+        }
+        candidates_.clear();
+        candidates_.reserve(n);
+        coords_.resize(6 * n);
+        double* x1 = &coords_[0];
+        double* y1 = x1 + n;
+        double* x2 = y1 + n;
+        double* y2 = x2 + n;
+        double* x3 = y2 + n;
+        double* y3 = x3 + n;
+
+        std::size_t i = 0;
+        for (Face_iterator iter = mesh_->faces_begin(); iter != mesh_->faces_end(); ++iter, ++i) {
+            Point2 p1, p2, p3;
+            iter->vertices(p1, p2, p3);
+            x1[i] = p1.x(); y1[i] = p1.y();
+            x2[i] = p2.x(); y2[i] = p2.y();
+            x3[i] = p3.x(); y3[i] = p3.y();
+            candidates_.push_back(iter);
+        }
+
+        flags_.resize(n);
+        if (size_.empty()) {
+            double const twice_area = 2.0 * max_area_ * (1.0 - 1e-9);
+            double const sin_angle = std::sin(std::min(min_angle_, utils::degrees_to_radians(90.0)));
+            double const sin2 = sin_angle * sin_angle * (1.0 + 1e-9);
+            for (std::size_t j = 0; j < n; ++j) {
+                double ax = x2[j] - x1[j], ay = y2[j] - y1[j];
+                double bx = x3[j] - x2[j], by = y3[j] - y2[j];
+                double cx = x1[j] - x3[j], cy = y1[j] - y3[j];
+                double la = ax * ax + ay * ay;
+                double lb = bx * bx + by * by;
+                double lc = cx * cx + cy * cy;
+                double lmin = std::min(la, std::min(lb, lc));
+                double a2 = cx * ay - cy * ax;
+                flags_[j] = (a2 > twice_area) | (a2 * a2 * lmin < sin2 * la * lb * lc);
             }
+        } else {
+            std::fill(flags_.begin(), flags_.end(), 1);
         }
-    }
 
-    void clear_undo_stack() {
-       while (!undo_stack_.empty()) {
-            undo_stack_.pop();
+        for (std::size_t j = 0; j < n; ++j) {
+            if (flags_[j]) {
+                enqueue_bad_face(candidates_[j]);
+            }
         }
     }
 
-    Face_handle get_bad_face () {
-        BOOST_ASSERT(!bad_faces_.empty());
+    void enqueue_bad_face (Face_handle f) {
+        if (f != Face_handle()) {
+            Quality q(f);
+            double h = face_size(f);
+            if (is_bad(q, h)) {
+                bad_faces_.insert(q);
+                if (!size_.empty()) {
+                    face_sizes_[&*f] = h;
+                }
+            }
+        }
     }
 
-    Face_handle get_original_bad_face(Node_handle n1, Node_handle n2, Node_handle n3) const {
-        typename Bad_faces::iterator iter = bad_faces_.begin();
-        Node_handle fn1, fn2, fn3;
-        for (; iter != bad_faces_.end(); ++iter) {
-            iter->face()->nodes(fn1, fn2, fn3);
-            if (fn1 == n1 && fn2 == n2 && fn3 == n3 ) return iter->face();
-            if (fn1 == n2 && fn2 == n3 && fn3 == n1 ) return iter->face();
-            if (fn1 == n3 && fn2 == n1 && fn3 == n2 ) return iter->face();
+    void dequeue_bad_face (Face_handle f)
+    {
+        if (f != Face_handle()) {
+            bad_faces_.erase(Quality(f));
+            face_sizes_.erase(&*f);
         }
-        return Face_handle();
     }
 
     Delaunay_triangulation* mesh_;
+    bool                    resumable_;
     double                  max_area_, min_angle_;
+    Size_function           size_;
+    Face_sizes              face_sizes_;
     Encroached_halfedges    enc_hedges_;
     Bad_faces               bad_faces_;
-    Undo_stack              undo_stack_;
+    Faces                   cavity_faces_;
+    Halfedges               cavity_boundary_;
+    Faces                   candidates_;
+    std::vector<double>     coords_;
+    std::vector<unsigned char> flags_;
+    unsigned                num_threads_;
+    std::size_t             face_limit_;
+    Limits                  limits_;
+    Report                  report_;
+    boost::posix_time::ptime start_time_;
+    boost::shared_ptr<Thread_pool> pool_;
+    Faces                   batch_;
+    std::vector<Insertion>  insertions_;
+    boost::unordered_set<Node_handle, Node_handle_hash> claimed_nodes_;
 };
 
 } // namespace umeshu
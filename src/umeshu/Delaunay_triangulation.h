@@ -28,6 +28,12 @@
 #include <boost/unordered/unordered_set.hpp>
 #include <boost/pool/pool_alloc.hpp>
 
+#include <cmath>
+#include <deque>
+#include <queue>
+#include <stack>
+#include <vector>
+
 namespace umeshu
 {
 
@@ -62,37 +68,467 @@ public:
 
   void make_cdt()
   {
-    boost::unordered_set<Edge_iterator, edge_iterator_hash> edges_to_flip;
+    Edge_queue edges_to_flip;
 
     for ( Edge_iterator iter = this->edges_begin(); iter != this->edges_end(); ++iter )
     {
       if ( !iter->is_constrained_delaunay() )
       {
-        edges_to_flip.insert( iter );
+        edges_to_flip.push_back( iter );
       }
     }
 
-    while ( !edges_to_flip.empty() )
+    flip_edges( edges_to_flip, NULL );
+  }
+
+  // Restores the constrained Delaunay property of a triangulation in which
+  // only the given edges can violate it, e.g., after gluing constrained
+  // Delaunay pieces along them. The edges flipped on the way are appended
+  // to flipped, so that the caller knows which faces have changed.
+  void make_cdt( std::vector<Edge_handle> const& edges, std::vector<Edge_handle>& flipped )
+  {
+    Edge_queue edges_to_flip( edges.begin(), edges.end() );
+    flip_edges( edges_to_flip, &flipped );
+  }
+
+  // Collects the faces whose circumcircles contain p (the Delaunay cavity of
+  // p), starting from start_face which has to contain p. The cavity does not
+  // grow across constrained and boundary edges. The halfedges bounding the
+  // cavity are returned in counter-clockwise order.
+  void get_cavity( Point2 const& p, Face_handle start_face, std::vector<Face_handle>& faces, std::vector<Halfedge_handle>& boundary ) const
+  {
+    faces.clear();
+    boundary.clear();
+
+    boost::unordered_set<Face_handle, face_handle_hash> in_cavity;
+    std::stack<Face_handle> to_visit;
+    in_cavity.insert( start_face );
+    to_visit.push( start_face );
+
+    Halfedge_handle bhe_start;
+
+    while ( !to_visit.empty() )
+    {
+      Face_handle f = to_visit.top();
+      to_visit.pop();
+      faces.push_back( f );
+
+      Halfedge_handle he = f->halfedge();
+
+      for ( int i = 0; i < 3; ++i, he = he->next() )
+      {
+        Face_handle g = he->pair()->face();
+
+        if ( g == Face_handle() || he->edge()->is_constrained() )
+        {
+          bhe_start = he;
+          continue;
+        }
+
+        if ( in_cavity.find( g ) != in_cavity.end() )
+        {
+          continue;
+        }
+
+        Point2 p1, p2, p3;
+        g->vertices( p1, p2, p3 );
+
+        if ( Kernel::oriented_circle( p1, p2, p3, p ) == ON_POSITIVE_SIDE )
+        {
+          in_cavity.insert( g );
+          to_visit.push( g );
+        }
+        else
+        {
+          bhe_start = he;
+        }
+      }
+    }
+
+    // walk around the cavity
+    Halfedge_handle bhe_iter = bhe_start;
+
+    do
+    {
+      boundary.push_back( bhe_iter );
+      bhe_iter = bhe_iter->next();
+
+      while ( !is_cavity_boundary( bhe_iter, in_cavity ) )
+      {
+        bhe_iter = bhe_iter->pair()->next();
+      }
+    }
+    while ( bhe_iter != bhe_start );
+  }
+
+  // Inserts p keeping the triangulation constrained Delaunay. The point has
+  // to lie inside the triangulation or on its boundary.
+  Node_handle insert( Point2 const& p, Face_handle start_face = Face_handle() )
+  {
+    Point_location loc;
+    Node_handle on_node;
+    Edge_handle on_edge;
+    Face_handle f = this->locate( p, loc, on_node, on_edge, start_face );
+
+    switch ( loc )
+    {
+    case ON_NODE:
+      return on_node;
+
+    case ON_EDGE:
+      f = on_edge->he1()->is_boundary() ? on_edge->he2()->face() : on_edge->he1()->face();
+      break;
+
+    case OUTSIDE_MESH:
+      BOOST_THROW_EXCEPTION( triangulation_error() << errinfo_desc( "cannot insert a point outside of the triangulation" ) );
+
+    default:
+      break;
+    }
+
+    std::vector<Face_handle> faces;
+    std::vector<Halfedge_handle> boundary;
+    get_cavity( p, f, faces, boundary );
+    return insert_in_cavity( p, faces, boundary );
+  }
+
+  // Replaces the cavity computed by get_cavity() with a star of triangles
+  // around a new node at p. If p lies on a boundary edge of the
+  // triangulation, the edge is split.
+  Node_handle insert_in_cavity( Point2 const& p, std::vector<Face_handle> const& faces, std::vector<Halfedge_handle> const& boundary )
+  {
+    boost::unordered_set<Face_handle, face_handle_hash> in_cavity( faces.begin(), faces.end() );
+    std::vector<Edge_handle> interior_edges;
+
+    for ( typename std::vector<Face_handle>::const_iterator iter = faces.begin(); iter != faces.end(); ++iter )
+    {
+      Halfedge_handle he = ( *iter )->halfedge();
+
+      for ( int i = 0; i < 3; ++i, he = he->next() )
+      {
+        // every interior edge is seen from both sides, take it only once
+        if ( !is_cavity_boundary( he, in_cavity ) && he == he->edge()->he1() )
+        {
+          interior_edges.push_back( he->edge() );
+        }
+      }
+    }
+
+    std::size_t n = boundary.size();
+    std::vector<Node_handle> origins( n );
+    std::vector<bool> split( n, false );
+
+    for ( std::size_t i = 0; i < n; ++i )
     {
-      Edge_handle e = *edges_to_flip.begin();
-      edges_to_flip.erase( edges_to_flip.begin() );
+      origins[i] = boundary[i]->origin();
+
+      if ( Kernel::oriented_side( origins[i]->position(), boundary[i]->pair()->origin()->position(), p ) == ON_ORIENTED_BOUNDARY )
+      {
+        BOOST_ASSERT( boundary[i]->pair()->is_boundary() );
+        split[i] = true;
+        interior_edges.push_back( boundary[i]->edge() );
+      }
+    }
+
+    for ( typename std::vector<Face_handle>::const_iterator iter = faces.begin(); iter != faces.end(); ++iter )
+    {
+      this->remove_face( *iter );
+    }
+
+    for ( typename std::vector<Edge_handle>::const_iterator iter = interior_edges.begin(); iter != interior_edges.end(); ++iter )
+    {
+      this->remove_edge( *iter );
+    }
+
+    Node_handle n_new = this->add_node( p );
+    std::vector<Halfedge_handle> spokes( n );
+
+    for ( std::size_t i = 0; i < n; ++i )
+    {
+      spokes[i] = this->add_edge( n_new, origins[i] );
+    }
+
+    for ( std::size_t i = 0; i < n; ++i )
+    {
+      if ( !split[i] )
+      {
+        this->add_face( spokes[i], boundary[i], spokes[( i + 1 ) % n]->pair() );
+      }
+    }
+
+    return n_new;
+  }
+
+  // Nodes that can be removed by remove(): interior nodes none of whose
+  // edges is constrained, and nodes splitting a straight boundary or
+  // constrained segment into two of their edges.
+  bool is_removable( Node_handle n ) const
+  {
+    Halfedge_handle cuts[2];
+    int num_cuts = find_cut_spokes( n, cuts );
+
+    if ( num_cuts == 0 )
+    {
+      return true;
+    }
+
+    if ( num_cuts != 2 )
+    {
+      return false;
+    }
+
+    // Split points are computed in floating point, so they are collinear
+    // with the ends of the segment only up to rounding.
+    Point2 const& a = cuts[0]->pair()->origin()->position();
+    Point2 const& b = cuts[1]->pair()->origin()->position();
+    Point2 const& p = n->position();
+    Point2 d = b - a;
+    double cross = d.x() * ( p.y() - a.y() ) - d.y() * ( p.x() - a.x() );
+    return std::abs( cross ) <= 1e-12 * d.squaredNorm() && ( p - a ).dot( b - p ) > 0.0;
+  }
+
+  // Removes the node and retriangulates the polygon formed by its
+  // neighbours. If the node splits a boundary or constrained segment, the
+  // two halves are joined into one edge, which divides the polygon in two.
+  // Each polygon is triangulated by cutting off ears taken from a queue
+  // ordered by the power of the removed point with respect to their
+  // circumcircles, the ear with the smallest power being a Delaunay
+  // triangle (O. Devillers, On deletion in Delaunay triangulations, 1999).
+  // Edges of the polygon can be constrained, so the new edges are then
+  // checked by flipping as in make_cdt(). The other nodes keep their
+  // handles.
+  void remove( Node_handle n )
+  {
+    BOOST_ASSERT( is_removable( n ) );
+
+    Halfedge_handle cuts[2];
+    int num_cuts = find_cut_spokes( n, cuts );
+
+    // the edges opposite to n in counter-clockwise order, split by the cuts
+    std::vector<Halfedge_handle> polygons[2];
+    Halfedge_handle start = num_cuts == 0 ? n->halfedge() : cuts[0];
+    Halfedge_handle he = start;
+    int k = 0;
+
+    do
+    {
+      if ( he == cuts[1] )
+      {
+        k = 1;
+      }
+
+      if ( !he->is_boundary() )
+      {
+        polygons[k].push_back( he->next() );
+      }
+
+      he = he->prev()->pair();
+    }
+    while ( he != start );
+
+    Point2 p = n->position();
+    Node_handle a, b;
+    bool constrained = false;
+
+    if ( num_cuts == 2 )
+    {
+      a = cuts[0]->pair()->origin();
+      b = cuts[1]->pair()->origin();
+      constrained = cuts[0]->edge()->is_constrained() && cuts[1]->edge()->is_constrained();
+    }
+
+    this->remove_node( n );
+
+    if ( num_cuts == 2 )
+    {
+      Halfedge_handle ab = this->add_edge( a, b );
+      ab->edge()->set_constrained( constrained );
+      polygons[0].push_back( ab->pair() );
+      polygons[1].push_back( ab );
+    }
+
+    std::vector<Edge_handle> new_edges;
+
+    for ( int i = 0; i < 2; ++i )
+    {
+      if ( polygons[i].size() >= 3 )
+      {
+        triangulate_polygon( polygons[i], p, new_edges );
+      }
+    }
+
+    while ( !new_edges.empty() )
+    {
+      Edge_handle e = new_edges.back();
+      new_edges.pop_back();
 
       if ( !e->is_diagonal_of_convex_quadrilateral() || e->is_constrained_delaunay() )
       {
         continue;
       }
 
-      Halfedge_handle he = e->he1();
-      edges_to_flip.insert( he->next()->edge() );
-      edges_to_flip.insert( he->prev()->edge() );
-      edges_to_flip.insert( he->pair()->next()->edge() );
-      edges_to_flip.insert( he->pair()->prev()->edge() );
+      Halfedge_handle h = e->he1();
+      new_edges.push_back( h->next()->edge() );
+      new_edges.push_back( h->prev()->edge() );
+      new_edges.push_back( h->pair()->next()->edge() );
+      new_edges.push_back( h->pair()->prev()->edge() );
       e->flip();
     }
   }
 
 private:
 
+  // The outgoing boundary and constrained edges of n; returns their number,
+  // counting at most three.
+  int find_cut_spokes( Node_handle n, Halfedge_handle cuts[2] ) const
+  {
+    int num_cuts = 0;
+    Halfedge_handle he = n->halfedge();
+
+    do
+    {
+      if ( he->edge()->is_boundary() || he->edge()->is_constrained() )
+      {
+        if ( num_cuts == 2 )
+        {
+          return 3;
+        }
+
+        cuts[num_cuts++] = he;
+      }
+
+      he = he->prev()->pair();
+    }
+    while ( he != n->halfedge() );
+
+    return num_cuts;
+  }
+
+  struct Ear
+  {
+    double power;
+    std::size_t index;
+    unsigned stamp;
+
+    bool operator<( Ear const& e ) const
+    {
+      return power > e.power;
+    }
+  };
+
+  // Triangulates the hole bounded by the halfedges of the polygon, given in
+  // counter-clockwise order, with respect to the removed point p. The ear
+  // at a vertex is formed by its incoming and outgoing halfedge, and is
+  // queued again with a new stamp whenever one of them changes.
+  void triangulate_polygon( std::vector<Halfedge_handle>& polygon, Point2 const& p, std::vector<Edge_handle>& new_edges )
+  {
+    std::size_t k = polygon.size();
+    std::vector<std::size_t> next( k ), prev( k );
+    std::vector<unsigned> stamps( k, 0 );
+    std::priority_queue<Ear> ears;
+
+    for ( std::size_t i = 0; i < k; ++i )
+    {
+      next[i] = ( i + 1 ) % k;
+      prev[next[i]] = i;
+    }
+
+    for ( std::size_t i = 0; i < k; ++i )
+    {
+      queue_ear( polygon, next, i, stamps[i], p, ears );
+    }
+
+    std::size_t first = 0;
+
+    while ( k > 3 )
+    {
+      if ( ears.empty() )
+      {
+        // cutting an ear can uncover an ear which has not changed
+        std::size_t i = first;
+
+        do
+        {
+          queue_ear( polygon, next, i, ++stamps[i], p, ears );
+          i = next[i];
+        }
+        while ( i != first );
+
+        BOOST_ASSERT( !ears.empty() );
+      }
+
+      Ear ear = ears.top();
+      ears.pop();
+
+      if ( ear.stamp != stamps[ear.index] )
+      {
+        continue;
+      }
+
+      std::size_t i = ear.index;
+      std::size_t j = next[i];
+      Halfedge_handle diagonal = this->add_edge( polygon[j]->pair()->origin(), polygon[i]->origin() );
+      this->add_face( polygon[i], polygon[j], diagonal );
+      new_edges.push_back( diagonal->edge() );
+
+      polygon[i] = diagonal->pair();
+      ++stamps[j];
+      next[i] = next[j];
+      prev[next[j]] = i;
+      first = i;
+      --k;
+
+      queue_ear( polygon, next, i, ++stamps[i], p, ears );
+      queue_ear( polygon, next, prev[i], ++stamps[prev[i]], p, ears );
+    }
+
+    this->add_face( polygon[first], polygon[next[first]], polygon[next[next[first]]] );
+  }
+
+  // Queues the ear at the i-th halfedge if it is convex and contains no
+  // other vertex of the polygon.
+  static void queue_ear( std::vector<Halfedge_handle> const& polygon, std::vector<std::size_t> const& next, std::size_t i, unsigned stamp, Point2 const& p, std::priority_queue<Ear>& ears )
+  {
+    std::size_t j = next[i];
+    Point2 const& p1 = polygon[i]->origin()->position();
+    Point2 const& p2 = polygon[j]->origin()->position();
+    Point2 const& p3 = polygon[next[j]]->origin()->position();
+
+    if ( Kernel::oriented_side( p1, p2, p3 ) != ON_POSITIVE_SIDE )
+    {
+      return;
+    }
+
+    for ( std::size_t l = next[next[j]]; l != i; l = next[l] )
+    {
+      Point2 const& q = polygon[l]->origin()->position();
+
+      if ( Kernel::oriented_side( p1, p2, q ) != ON_NEGATIVE_SIDE &&
+           Kernel::oriented_side( p2, p3, q ) != ON_NEGATIVE_SIDE &&
+           Kernel::oriented_side( p3, p1, q ) != ON_NEGATIVE_SIDE )
+      {
+        return;
+      }
+    }
+
+    Point2 c = Kernel::circumcenter( p1, p2, p3 );
+    Ear ear = { ( p - c ).squaredNorm() - ( p1 - c ).squaredNorm(), i, stamp };
+    ears.push( ear );
+  }
+  struct face_handle_hash
+  {
+    std::size_t operator()( Face_handle f ) const
+    {
+      return boost::hash<Face*>()( &( *f ) );
+    }
+  };
+
+  static bool is_cavity_boundary( Halfedge_handle he, boost::unordered_set<Face_handle, face_handle_hash> const& in_cavity )
+  {
+    Face_handle g = he->pair()->face();
+    return g == Face_handle() || he->edge()->is_constrained() || in_cavity.find( g ) == in_cavity.end();
+  }
+
   struct edge_iterator_hash
   {
     std::size_t operator()( Edge_iterator e ) const
@@ -101,6 +537,46 @@ private:
     }
   };
 
+  typedef boost::unordered_set<Edge_iterator, edge_iterator_hash> Edge_set;
+  typedef std::deque<Edge_handle> Edge_queue;
+
+  // The edges are flipped in the order in which they are queued, so that
+  // with cocircular points the result does not depend on where the edges
+  // lie in memory.
+  void flip_edges( Edge_queue& edges_to_flip, std::vector<Edge_handle>* flipped )
+  {
+    Edge_set queued( edges_to_flip.begin(), edges_to_flip.end() );
+
+    while ( !edges_to_flip.empty() )
+    {
+      Edge_handle e = edges_to_flip.front();
+      edges_to_flip.pop_front();
+      queued.erase( e );
+
+      if ( !e->is_diagonal_of_convex_quadrilateral() || e->is_constrained_delaunay() )
+      {
+        continue;
+      }
+
+      Halfedge_handle he = e->he1();
+      Edge_handle neighbours[] = { he->next()->edge(), he->prev()->edge(), he->pair()->next()->edge(), he->pair()->prev()->edge() };
+      e->flip();
+
+      for ( int i = 0; i < 4; ++i )
+      {
+        if ( queued.insert( neighbours[i] ).second )
+        {
+          edges_to_flip.push_back( neighbours[i] );
+        }
+      }
+
+      if ( flipped )
+      {
+        flipped->push_back( e );
+      }
+    }
+  }
+
 };
 
 } // namespace umeshu
@@ -0,0 +1,565 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+#ifndef UMESHU_DOMAIN_DECOMPOSITION_MESHER_H
+#define UMESHU_DOMAIN_DECOMPOSITION_MESHER_H
+
+#include "Delaunay_mesher.h"
+#include "Delaunay_triangulation.h"
+#include "Polygon.h"
+#include "Thread_pool.h"
+#include "Triangulator.h"
+
+#include <boost/bind/bind.hpp>
+#include <boost/geometry/algorithms/envelope.hpp>
+#include <boost/geometry/algorithms/intersection.hpp>
+#include <boost/geometry/geometries/multi_polygon.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace umeshu
+{
+
+// Meshes a polygon by cutting it into vertical strips which are triangulated
+// and refined independently, each on its own thread. The cut lines are
+// pre-split with the same nodes on both sides, nodes added later by the
+// refinement on one side of a cut are copied to the other side, and the
+// conforming pieces are finally stitched together into one triangulation.
+// The edges along the cuts are then flipped to make it constrained Delaunay
+// and the faces around the cuts spoiled by the copied nodes are refined,
+// starting only from the faces around the nodes on the cuts. Polygons with
+// holes are rejected.
+template <typename Delaunay_triangulation_>
+class Domain_decomposition_mesher
+{
+public:
+  typedef          Delaunay_triangulation_ Tria;
+  typedef typename Tria::Items             Items;
+  typedef typename Tria::Kernel            Kernel;
+
+  typedef typename Tria::Node              Node;
+
+  typedef typename Tria::Node_handle       Node_handle;
+  typedef typename Tria::Halfedge_handle   Halfedge_handle;
+  typedef typename Tria::Edge_handle       Edge_handle;
+  typedef typename Tria::Face_handle       Face_handle;
+
+  // subdomains use the standard allocator so that the threads do not
+  // contend for the singleton pool of the default one
+  typedef Delaunay_triangulation<Items, Kernel, std::allocator<int> > Subdomain_tria;
+
+  Domain_decomposition_mesher()
+    : num_subdomains_( 2 )
+    , num_threads_( 1 )
+    , max_area_( 1.0 )
+    , min_angle_( 20.0 )
+  {}
+
+  void set_num_subdomains( unsigned num_subdomains )
+  {
+    num_subdomains_ = std::max( num_subdomains, 1u );
+  }
+
+  void set_num_threads( unsigned num_threads )
+  {
+    num_threads_ = std::max( num_threads, 1u );
+  }
+
+  void mesh( Polygon const& poly, Tria& tria, double max_area, double min_angle );
+
+  struct domain_decomposition_error : virtual umeshu_error {};
+
+private:
+
+  typedef boost::geometry::model::multi_polygon<Polygon> Multi_polygon;
+  typedef typename Subdomain_tria::Node_iterator Subdomain_node_iterator;
+  typedef typename Subdomain_tria::Face_iterator Subdomain_face_iterator;
+  typedef typename Subdomain_tria::Node_handle Subdomain_node_handle;
+  typedef typename Subdomain_tria::Halfedge_handle Subdomain_halfedge_handle;
+
+  struct Subdomain
+  {
+    Polygon poly;
+    Subdomain_tria tria;
+    unsigned strip;
+  };
+
+  void split_into_subdomains( Polygon const& poly );
+  void add_subdomain( Polygon const& piece, unsigned strip );
+  Point2 snap_to_cut( Point2 p ) const;
+
+  void run_in_parallel( void ( Domain_decomposition_mesher::*job )( std::size_t ) );
+  void run_jobs( void ( Domain_decomposition_mesher::*job )( std::size_t ), unsigned thread );
+  void mesh_subdomain( std::size_t i );
+
+  void synchronize_interface( std::size_t cut );
+  void collect_interface_nodes( std::size_t cut, unsigned strip, std::set<double>& ys ) const;
+  void insert_interface_node( std::size_t cut, unsigned strip, double y );
+
+  void stitch( Tria& tria, std::vector<Node_handle>& interface_nodes );
+  void repair_interfaces( Tria& tria, std::vector<Node_handle> const& interface_nodes );
+
+  unsigned num_subdomains_, num_threads_;
+  double max_area_, min_angle_;
+  std::vector<double> cuts_;
+  std::vector< std::vector<double> > crossings_;
+  boost::ptr_vector<Subdomain> subdomains_;
+  boost::mutex jobs_mutex_;
+  std::size_t next_job_;
+};
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::mesh( Polygon const& poly, Tria& tria, double max_area, double min_angle )
+{
+  if ( !poly.inners().empty() )
+  {
+    BOOST_THROW_EXCEPTION( domain_decomposition_error() << errinfo_desc( "polygons with holes are not supported" ) );
+  }
+
+  max_area_ = max_area;
+  min_angle_ = min_angle;
+
+  split_into_subdomains( poly );
+  run_in_parallel( &Domain_decomposition_mesher::mesh_subdomain );
+
+  // Refining the subdomains again after copying the nodes would split the
+  // interfaces anew, possibly differently on each side, so it is left for
+  // the stitched triangulation where the cuts are no longer boundaries.
+  for ( std::size_t cut = 0; cut < cuts_.size(); ++cut )
+  {
+    synchronize_interface( cut );
+  }
+
+  std::vector<Node_handle> interface_nodes;
+  stitch( tria, interface_nodes );
+  subdomains_.clear();
+
+  repair_interfaces( tria, interface_nodes );
+}
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::split_into_subdomains( Polygon const& poly )
+{
+  Bounding_box bbox;
+  boost::geometry::envelope( poly, bbox );
+  double xmin = bbox.min_corner().x();
+  double xmax = bbox.max_corner().x();
+  double ymin = bbox.min_corner().y();
+  double ymax = bbox.max_corner().y();
+  double margin = ymax - ymin;
+
+  cuts_.clear();
+  crossings_.clear();
+  subdomains_.clear();
+
+  for ( unsigned i = 1; i < num_subdomains_; ++i )
+  {
+    cuts_.push_back( xmin + i * ( xmax - xmin ) / num_subdomains_ );
+  }
+
+  // The intersections of the boundary with the cut lines are computed here
+  // once, so that the pieces on both sides of a cut get identical nodes.
+  std::vector<Point2> const& ring = poly.outer();
+  crossings_.resize( cuts_.size() );
+
+  for ( std::size_t cut = 0; cut < cuts_.size(); ++cut )
+  {
+    double c = cuts_[cut];
+
+    for ( std::size_t i = 0; i + 1 < ring.size(); ++i )
+    {
+      Point2 p = ring[i];
+      Point2 q = ring[i + 1];
+
+      if ( p.x() > q.x() )
+      {
+        std::swap( p, q );
+      }
+
+      if ( p.x() <= c && c <= q.x() && p.x() < q.x() )
+      {
+        crossings_[cut].push_back( p.y() + ( c - p.x() ) * ( q.y() - p.y() ) / ( q.x() - p.x() ) );
+      }
+    }
+  }
+
+  for ( unsigned strip = 0; strip < num_subdomains_; ++strip )
+  {
+    double left = strip == 0 ? xmin - margin : cuts_[strip - 1];
+    double right = strip + 1 == num_subdomains_ ? xmax + margin : cuts_[strip];
+    Bounding_box box( Point2( left, ymin - margin ), Point2( right, ymax + margin ) );
+
+    Multi_polygon pieces;
+    boost::geometry::intersection( poly, box, pieces );
+
+    for ( typename Multi_polygon::const_iterator iter = pieces.begin(); iter != pieces.end(); ++iter )
+    {
+      add_subdomain( *iter, strip );
+    }
+  }
+}
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::add_subdomain( Polygon const& piece, unsigned strip )
+{
+  // target length of an edge of an equilateral triangle with area max_area
+  double h = std::sqrt( 4.0 * max_area_ / std::sqrt( 3.0 ) );
+
+  std::vector<Point2> ring;
+
+  for ( std::size_t i = 0; i < piece.outer().size(); ++i )
+  {
+    Point2 p = snap_to_cut( piece.outer()[i] );
+
+    if ( ring.empty() || p != ring.back() )
+    {
+      ring.push_back( p );
+    }
+  }
+
+  if ( ring.size() < 4 )
+  {
+    return;
+  }
+
+  Polygon sub_poly;
+
+  for ( std::size_t i = 0; i + 1 < ring.size(); ++i )
+  {
+    Point2 const& p = ring[i];
+    Point2 const& q = ring[i + 1];
+    sub_poly.outer().push_back( p );
+
+    // pre-split the interface on a grid shared by both sides of the cut
+    if ( p.x() == q.x() && std::find( cuts_.begin(), cuts_.end(), p.x() ) != cuts_.end() )
+    {
+      double lo = std::min( p.y(), q.y() ) + 0.5 * h;
+      double hi = std::max( p.y(), q.y() ) - 0.5 * h;
+      std::vector<double> ys;
+
+      for ( double k = std::ceil( lo / h ); k * h < hi; k += 1.0 )
+      {
+        ys.push_back( k * h );
+      }
+
+      if ( p.y() > q.y() )
+      {
+        std::reverse( ys.begin(), ys.end() );
+      }
+
+      for ( std::size_t j = 0; j < ys.size(); ++j )
+      {
+        sub_poly.outer().push_back( Point2( p.x(), ys[j] ) );
+      }
+    }
+  }
+
+  sub_poly.outer().push_back( ring.back() );
+
+  if ( boost::geometry::area( sub_poly ) != 0.0 )
+  {
+    subdomains_.push_back( new Subdomain );
+    subdomains_.back().poly = sub_poly;
+    subdomains_.back().strip = strip;
+  }
+}
+
+template <typename Delaunay_triangulation_>
+Point2 Domain_decomposition_mesher<Delaunay_triangulation_>::snap_to_cut( Point2 p ) const
+{
+  for ( std::size_t cut = 0; cut < cuts_.size(); ++cut )
+  {
+    double c = cuts_[cut];
+    double tol = 1e-10 * std::max( 1.0, std::abs( c ) );
+
+    if ( std::abs( p.x() - c ) > tol )
+    {
+      continue;
+    }
+
+    p.x() = c;
+
+    for ( std::size_t i = 0; i < crossings_[cut].size(); ++i )
+    {
+      double y = crossings_[cut][i];
+
+      if ( std::abs( p.y() - y ) <= 1e-10 * std::max( 1.0, std::abs( y ) ) )
+      {
+        p.y() = y;
+        break;
+      }
+    }
+  }
+
+  return p;
+}
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::run_in_parallel( void ( Domain_decomposition_mesher::*job )( std::size_t ) )
+{
+  next_job_ = 0;
+  Thread_pool pool( static_cast<unsigned>( std::min<std::size_t>( num_threads_, subdomains_.size() ) ) );
+  pool.run( boost::bind( &Domain_decomposition_mesher::run_jobs, this, job, boost::placeholders::_1 ) );
+}
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::run_jobs( void ( Domain_decomposition_mesher::*job )( std::size_t ), unsigned /* thread */ )
+{
+  while ( true )
+  {
+    std::size_t i;
+    {
+      boost::mutex::scoped_lock lock( jobs_mutex_ );
+
+      if ( next_job_ == subdomains_.size() )
+      {
+        return;
+      }
+
+      i = next_job_++;
+    }
+    ( this->*job )( i );
+  }
+}
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::mesh_subdomain( std::size_t i )
+{
+  Subdomain& sub = subdomains_[i];
+  Triangulator<Subdomain_tria> triangulator;
+  triangulator.triangulate( sub.poly, sub.tria );
+  sub.tria.make_cdt();
+  Delaunay_mesher<Subdomain_tria> mesher;
+  mesher.refine( sub.tria, max_area_, min_angle_ );
+}
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::synchronize_interface( std::size_t cut )
+{
+  std::set<double> left, right;
+  collect_interface_nodes( cut, cut, left );
+  collect_interface_nodes( cut, cut + 1, right );
+
+  for ( std::set<double>::const_iterator iter = left.begin(); iter != left.end(); ++iter )
+  {
+    if ( right.find( *iter ) == right.end() )
+    {
+      insert_interface_node( cut, cut + 1, *iter );
+    }
+  }
+
+  for ( std::set<double>::const_iterator iter = right.begin(); iter != right.end(); ++iter )
+  {
+    if ( left.find( *iter ) == left.end() )
+    {
+      insert_interface_node( cut, cut, *iter );
+    }
+  }
+}
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::collect_interface_nodes( std::size_t cut, unsigned strip, std::set<double>& ys ) const
+{
+  for ( std::size_t i = 0; i < subdomains_.size(); ++i )
+  {
+    Subdomain const& sub = subdomains_[i];
+
+    if ( sub.strip != strip )
+    {
+      continue;
+    }
+
+    for ( typename Subdomain_tria::Node_const_iterator iter = sub.tria.nodes_begin(); iter != sub.tria.nodes_end(); ++iter )
+    {
+      if ( iter->position().x() == cuts_[cut] && iter->is_boundary() )
+      {
+        ys.insert( iter->position().y() );
+      }
+    }
+  }
+}
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::insert_interface_node( std::size_t cut, unsigned strip, double y )
+{
+  double c = cuts_[cut];
+
+  for ( std::size_t i = 0; i < subdomains_.size(); ++i )
+  {
+    Subdomain& sub = subdomains_[i];
+
+    if ( sub.strip != strip )
+    {
+      continue;
+    }
+
+    Subdomain_halfedge_handle bhe_start = sub.tria.boundary_halfedge();
+    Subdomain_halfedge_handle bhe_iter = bhe_start;
+
+    do
+    {
+      Point2 const& p = bhe_iter->origin()->position();
+      Point2 const& q = bhe_iter->pair()->origin()->position();
+
+      if ( p.x() == c && q.x() == c && std::min( p.y(), q.y() ) < y && y < std::max( p.y(), q.y() ) )
+      {
+        sub.tria.insert( Point2( c, y ), bhe_iter->pair()->face() );
+        return;
+      }
+
+      bhe_iter = bhe_iter->next();
+    }
+    while ( bhe_iter != bhe_start );
+  }
+}
+
+// Each piece is a conforming constrained Delaunay triangulation, so only the
+// edges along the cuts, which were constrained in the pieces, can violate
+// the Delaunay property, and only the faces around the cuts or changed by
+// the flips can be bad.
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::repair_interfaces( Tria& tria, std::vector<Node_handle> const& interface_nodes )
+{
+  typedef typename Delaunay_mesher<Tria>::Faces Faces;
+
+  std::vector<Edge_handle> edges, flipped;
+  Faces faces;
+
+  for ( typename std::vector<Node_handle>::const_iterator iter = interface_nodes.begin(); iter != interface_nodes.end(); ++iter )
+  {
+    Halfedge_handle he = ( *iter )->halfedge();
+
+    do
+    {
+      edges.push_back( he->edge() );
+      he = he->pair()->next();
+    }
+    while ( he != ( *iter )->halfedge() );
+  }
+
+  tria.make_cdt( edges, flipped );
+
+  for ( typename std::vector<Node_handle>::const_iterator iter = interface_nodes.begin(); iter != interface_nodes.end(); ++iter )
+  {
+    Halfedge_handle he = ( *iter )->halfedge();
+
+    do
+    {
+      if ( !he->is_boundary() )
+      {
+        faces.push_back( he->face() );
+      }
+
+      he = he->pair()->next();
+    }
+    while ( he != ( *iter )->halfedge() );
+  }
+
+  for ( typename std::vector<Edge_handle>::const_iterator iter = flipped.begin(); iter != flipped.end(); ++iter )
+  {
+    faces.push_back( ( *iter )->he1()->face() );
+    faces.push_back( ( *iter )->he2()->face() );
+  }
+
+  Delaunay_mesher<Tria> mesher;
+  mesher.set_num_threads( num_threads_ );
+  mesher.refine_faces( tria, faces, max_area_, min_angle_ );
+}
+
+template <typename Delaunay_triangulation_>
+void Domain_decomposition_mesher<Delaunay_triangulation_>::stitch( Tria& tria, std::vector<Node_handle>& interface_nodes )
+{
+  if ( tria.number_of_nodes() != 0 )
+  {
+    BOOST_THROW_EXCEPTION( domain_decomposition_error() << errinfo_desc( "the output triangulation is not empty" ) );
+  }
+
+  // nodes on the interfaces have bitwise identical coordinates on both sides
+  typedef std::map< std::pair<double, double>, Node_handle > Node_map;
+  typedef std::map< std::pair<Node*, Node*>, Halfedge_handle > Halfedge_map;
+  Node_map nodes;
+  Halfedge_map halfedges;
+
+  for ( std::size_t i = 0; i < subdomains_.size(); ++i )
+  {
+    Subdomain_tria& sub = subdomains_[i].tria;
+
+    for ( Subdomain_face_iterator iter = sub.faces_begin(); iter != sub.faces_end(); ++iter )
+    {
+      Subdomain_node_handle sn[3];
+      iter->nodes( sn[0], sn[1], sn[2] );
+      Node_handle n[3];
+
+      for ( int j = 0; j < 3; ++j )
+      {
+        Point2 const& p = sn[j]->position();
+        std::pair<typename Node_map::iterator, bool> res = nodes.insert( std::make_pair( std::make_pair( p.x(), p.y() ), Node_handle() ) );
+
+        if ( res.second )
+        {
+          res.first->second = tria.add_node( p );
+
+          if ( std::find( cuts_.begin(), cuts_.end(), p.x() ) != cuts_.end() )
+          {
+            interface_nodes.push_back( res.first->second );
+          }
+        }
+
+        n[j] = res.first->second;
+      }
+
+      Halfedge_handle he[3];
+
+      for ( int j = 0; j < 3; ++j )
+      {
+        Node* n1 = &*n[j];
+        Node* n2 = &*n[( j + 1 ) % 3];
+        typename Halfedge_map::iterator found = halfedges.find( std::make_pair( n1, n2 ) );
+
+        if ( found != halfedges.end() )
+        {
+          he[j] = found->second;
+        }
+        else
+        {
+          he[j] = tria.add_edge( n[j], n[( j + 1 ) % 3] );
+          halfedges.insert( std::make_pair( std::make_pair( n1, n2 ), he[j] ) );
+          halfedges.insert( std::make_pair( std::make_pair( n2, n1 ), he[j]->pair() ) );
+        }
+      }
+
+      tria.add_face( he[0], he[1], he[2] );
+    }
+  }
+}
+
+} // namespace umeshu
+
+#endif // UMESHU_DOMAIN_DECOMPOSITION_MESHER_H
@@ -20,7 +20,8 @@
 //  IN THE SOFTWARE.
 
 #include "Exact_adaptive_kernel.h"
-#include "Predicates.h"
+
+#include <iostream>
 
 void exactinit(void);
 
@@ -37,40 +38,6 @@ namespace
 namespace umeshu
 {
 
-Oriented_side Exact_adaptive_kernel::oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test )
-{
-  double r = orient2d( pa.data(), pb.data(), test.data() );
-
-  if ( r > 0.0 )
-  {
-    return ON_POSITIVE_SIDE;
-  }
-
-  if ( r < 0.0 )
-  {
-    return ON_NEGATIVE_SIDE;
-  }
-
-  return ON_ORIENTED_BOUNDARY;
-}
-
-Oriented_side Exact_adaptive_kernel::oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test )
-{
-  double r = incircle( pa.data(), pb.data(), pc.data(), test.data() );
-
-  if ( r > 0.0 )
-  {
-    return ON_POSITIVE_SIDE;
-  }
-
-  if ( r < 0.0 )
-  {
-    return ON_NEGATIVE_SIDE;
-  }
-
-  return ON_ORIENTED_BOUNDARY;
-}
-
 Point2 Exact_adaptive_kernel::circumcenter( Point2 const& a, Point2 const& b, Point2 const& c )
 {
   Point2 ba = b - a;
@@ -86,14 +53,27 @@ Point2 Exact_adaptive_kernel::offcenter( Point2 const& a, Point2 const& b, Point
 {
   Point2 ba = b - a;
   Point2 ca = c - a;
-  Point2 bc = b - c;
   double abdist = distance_squared( a, b );
   double acdist = distance_squared( a, c );
-  double bcdist = distance_squared( b, c );
   double denominator = 0.25 / signed_area( b, c, a );
   BOOST_ASSERT( denominator > 0.0 );
-  double dx = ( ca(1) * abdist - ba(1) * acdist ) * denominator;
-  double dy = ( ba(0) * acdist - ca(0) * abdist ) * denominator;
+  Point2 d( ( ca(1) * abdist - ba(1) * acdist ) * denominator, ( ba(0) * acdist - ca(0) * abdist ) * denominator );
+  return offcenter_from_circumcenter( a, b, c, d, offconstant );
+}
+
+// Ruppert's off-center: the circumcenter, unless it is farther from the
+// shortest edge than the point on the bisector of the edge seen from it at
+// the angle given by offconstant
+Point2 Exact_adaptive_kernel::offcenter_from_circumcenter( Point2 const& a, Point2 const& b, Point2 const& c, Point2 const& offset, double offconstant )
+{
+  Point2 ba = b - a;
+  Point2 ca = c - a;
+  Point2 bc = b - c;
+  double abdist = distance_squared( a, b );
+  double acdist = distance_squared( a, c );
+  double bcdist = distance_squared( b, c );
+  double dx = offset( 0 );
+  double dy = offset( 1 );
   double dxoff, dyoff;
 
   if ( ( abdist < acdist ) && ( abdist < bcdist ) )
@@ -133,9 +113,4 @@ Point2 Exact_adaptive_kernel::offcenter( Point2 const& a, Point2 const& b, Point
   return Point2( a(0) + dx, a(1) + dy );
 }
 
-double Exact_adaptive_kernel::signed_area( Point2 const& pa, Point2 const& pb, Point2 const& pc )
-{
-  return 0.5 * orient2d( pa.data(), pb.data(), pc.data() );
-}
-
 } // namespace umeshu
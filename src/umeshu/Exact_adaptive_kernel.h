@@ -24,6 +24,7 @@
 
 #include "Point2.h"
 #include "Orientation.h"
+#include "Predicates.h"
 
 #include <boost/math/constants/constants.hpp>
 
@@ -34,12 +35,33 @@ namespace umeshu
 
 struct Exact_adaptive_kernel
 {
-  static Oriented_side oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test );
-  static Oriented_side oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test );
+  // The floating-point stages of the predicates are inlined, only the
+  // adaptive stages are called out of line.
+  static Oriented_side oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test )
+  {
+    return to_oriented_side( orient2d( pa.data(), pb.data(), test.data() ) );
+  }
+
+  static Oriented_side oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test )
+  {
+    return to_oriented_side( incircle( pa.data(), pb.data(), pc.data(), test.data() ) );
+  }
+
+  // Rounds a point to the representable positions of the kernel; the
+  // triangulator, the mesher and the smoother pass the points they add
+  // through it. Here all points are representable.
+  static Point2 snap( Point2 const& p )
+  {
+    return p;
+  }
 
   static Point2 circumcenter( Point2 const& p1, Point2 const& p2, Point2 const& p3 );
   static Point2 offcenter( Point2 const& p1, Point2 const& p2, Point2 const& p3, double offconstant );
-  static double signed_area( Point2 const& pa, Point2 const& pb, Point2 const& pc );
+
+  static double signed_area( Point2 const& pa, Point2 const& pb, Point2 const& pc )
+  {
+    return 0.5 * orient2d( pa.data(), pb.data(), pc.data() );
+  }
 
   static double distance_squared( Point2 const& p1, Point2 const& p2 )
   {
@@ -85,6 +107,26 @@ struct Exact_adaptive_kernel
     const double one_third = boost::math::constants::third<double>();
     return one_third * ( p1 + p2 + p3 );
   }
+
+protected:
+
+  // The off-center given the offset of the circumcenter from a
+  static Point2 offcenter_from_circumcenter( Point2 const& a, Point2 const& b, Point2 const& c, Point2 const& offset, double offconstant );
+
+  static Oriented_side to_oriented_side( double r )
+  {
+    if ( r > 0.0 )
+    {
+      return ON_POSITIVE_SIDE;
+    }
+
+    if ( r < 0.0 )
+    {
+      return ON_NEGATIVE_SIDE;
+    }
+
+    return ON_ORIENTED_BOUNDARY;
+  }
 };
 
 } // namespace umeshu
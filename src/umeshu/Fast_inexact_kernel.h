@@ -0,0 +1,68 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+
+#ifndef UMESHU_FAST_INEXACT_KERNEL_H
+#define UMESHU_FAST_INEXACT_KERNEL_H
+
+#include "Exact_adaptive_kernel.h"
+
+namespace umeshu
+{
+
+// Kernel whose predicates take the sign of the determinant evaluated in
+// plain floating-point arithmetic, as orient2dfast() and incirclefast() do,
+// without any error bound. It is meant for well-conditioned inputs and as
+// the baseline against which the cost of the robust kernels is measured.
+// Near degeneracies the predicates can contradict each other, and the
+// algorithms can then fail or loop.
+struct Fast_inexact_kernel : public Exact_adaptive_kernel
+{
+  static Oriented_side oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test )
+  {
+    double det = ( pa( 0 ) - test( 0 ) ) * ( pb( 1 ) - test( 1 ) ) - ( pa( 1 ) - test( 1 ) ) * ( pb( 0 ) - test( 0 ) );
+    return to_oriented_side( det );
+  }
+
+  static Oriented_side oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test )
+  {
+    double adx = pa( 0 ) - test( 0 );
+    double bdx = pb( 0 ) - test( 0 );
+    double cdx = pc( 0 ) - test( 0 );
+    double ady = pa( 1 ) - test( 1 );
+    double bdy = pb( 1 ) - test( 1 );
+    double cdy = pc( 1 ) - test( 1 );
+    double det = ( adx * adx + ady * ady ) * ( bdx * cdy - cdx * bdy )
+               + ( bdx * bdx + bdy * bdy ) * ( cdx * ady - adx * cdy )
+               + ( cdx * cdx + cdy * cdy ) * ( adx * bdy - bdx * ady );
+    return to_oriented_side( det );
+  }
+
+  static double signed_area( Point2 const& pa, Point2 const& pb, Point2 const& pc )
+  {
+    return 0.5 * ( ( pa( 0 ) - pc( 0 ) ) * ( pb( 1 ) - pc( 1 ) ) - ( pa( 1 ) - pc( 1 ) ) * ( pb( 0 ) - pc( 0 ) ) );
+  }
+};
+
+} // namespace umeshu
+
+#endif // UMESHU_FAST_INEXACT_KERNEL_H
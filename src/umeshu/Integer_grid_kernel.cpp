@@ -0,0 +1,57 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+
+#include "Integer_grid_kernel.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+
+namespace umeshu
+{
+
+double Integer_grid_kernel::origin_x_ = 0.0;
+double Integer_grid_kernel::origin_y_ = 0.0;
+double Integer_grid_kernel::step_ = 0.0;
+double Integer_grid_kernel::inv_step_ = 0.0;
+
+// The spacing is the power of two such that the longer side of the box spans
+// at most 2^bits cells, and the origin is the multiple of the spacing at or
+// below the lower left corner.
+void Integer_grid_kernel::set_bounding_box( Bounding_box const& box, int bits )
+{
+  BOOST_ASSERT( bits > 0 && bits <= max_bits );
+
+  double size = std::max( box.max_corner()( 0 ) - box.min_corner()( 0 ), box.max_corner()( 1 ) - box.min_corner()( 1 ) );
+  BOOST_ASSERT( size > 0.0 );
+
+  int exponent;
+  std::frexp( size, &exponent );
+
+  step_ = std::ldexp( 1.0, exponent - bits );
+  inv_step_ = std::ldexp( 1.0, bits - exponent );
+  origin_x_ = std::floor( box.min_corner()( 0 ) * inv_step_ ) * step_;
+  origin_y_ = std::floor( box.min_corner()( 1 ) * inv_step_ ) * step_;
+}
+
+} // namespace umeshu
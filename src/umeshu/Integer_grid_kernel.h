@@ -0,0 +1,231 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+
+#ifndef UMESHU_INTEGER_GRID_KERNEL_H
+#define UMESHU_INTEGER_GRID_KERNEL_H
+
+#include "Bounding_box.h"
+#include "Exact_adaptive_kernel.h"
+
+#include <boost/cstdint.hpp>
+
+#include <cmath>
+
+namespace umeshu
+{
+
+// Kernel that rounds the points to a grid of spacing 2^e laid over a
+// bounding box of the input and evaluates the predicates on the integer grid
+// coordinates exactly, orient2d in 64-bit and incircle in 128-bit integer
+// arithmetic. The sign of the determinants involves neither rounding nor
+// adaptive stages, so the results, and the meshes built on them, do not
+// depend on the compiler or the platform. The points are put on the grid by
+// snap(), which the triangulator calls on the input vertices and the mesher
+// and the smoother on the points they create. The grid has 2^bits cells
+// along the longer side of the box; the integer path is taken for the points
+// on the grid within one box size of it, the other queries are decided by
+// the adaptive predicates of Exact_adaptive_kernel. Until set_bounding_box()
+// is called, snap() keeps the points as they are and all queries are
+// decided by the adaptive predicates. As with Semi_static_kernel, the grid
+// is shared by all triangulations using this kernel.
+//
+// Snapping moves the points created on boundary edges by up to half the
+// spacing off the edges, and input vertices closer than that may merge, so
+// the spacing has to be well below the smallest feature of the input.
+struct Integer_grid_kernel : public Exact_adaptive_kernel
+{
+  typedef boost::int64_t Integer;
+
+  // The largest number of cells for which the determinants cannot overflow
+  static int const max_bits = 28;
+
+  static void set_bounding_box( Bounding_box const& box, int bits = 26 );
+
+  static Point2 snap( Point2 const& p );
+
+  static Oriented_side oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test );
+  static Oriented_side oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test );
+
+private:
+
+  static bool to_grid( Point2 const& p, Integer& x, Integer& y );
+
+  static Oriented_side sign_of_sum_of_products( Integer a1, Integer b1, Integer a2, Integer b2, Integer a3, Integer b3 );
+
+  static double origin_x_;
+  static double origin_y_;
+  static double step_;
+  static double inv_step_;
+};
+
+namespace internal
+{
+
+#ifdef __SIZEOF_INT128__
+
+__extension__ typedef __int128 Int128;
+
+inline Int128 multiply( boost::int64_t a, boost::int64_t b )
+{
+  return static_cast<Int128>( a ) * b;
+}
+
+inline int sign( Int128 a )
+{
+  return ( a > 0 ) - ( a < 0 );
+}
+
+#else
+
+// Two's complement 128-bit integer for the compilers without a native one
+struct Int128
+{
+  boost::uint64_t hi;
+  boost::uint64_t lo;
+};
+
+inline Int128 operator+( Int128 a, Int128 b )
+{
+  Int128 r;
+  r.lo = a.lo + b.lo;
+  r.hi = a.hi + b.hi + ( r.lo < a.lo ? 1 : 0 );
+  return r;
+}
+
+inline Int128 multiply( boost::int64_t a, boost::int64_t b )
+{
+  boost::uint64_t const low = 0xffffffffu;
+  boost::uint64_t ua = a < 0 ? -static_cast<boost::uint64_t>( a ) : static_cast<boost::uint64_t>( a );
+  boost::uint64_t ub = b < 0 ? -static_cast<boost::uint64_t>( b ) : static_cast<boost::uint64_t>( b );
+
+  boost::uint64_t p00 = ( ua & low ) * ( ub & low );
+  boost::uint64_t p01 = ( ua & low ) * ( ub >> 32 );
+  boost::uint64_t p10 = ( ua >> 32 ) * ( ub & low );
+  boost::uint64_t p11 = ( ua >> 32 ) * ( ub >> 32 );
+  boost::uint64_t mid = ( p00 >> 32 ) + ( p01 & low ) + ( p10 & low );
+
+  Int128 r;
+  r.lo = ( mid << 32 ) | ( p00 & low );
+  r.hi = p11 + ( p01 >> 32 ) + ( p10 >> 32 ) + ( mid >> 32 );
+
+  if ( ( a < 0 ) != ( b < 0 ) )
+  {
+    r.lo = ~r.lo + 1;
+    r.hi = ~r.hi + ( r.lo == 0 ? 1 : 0 );
+  }
+
+  return r;
+}
+
+inline int sign( Int128 a )
+{
+  if ( a.hi >> 63 )
+  {
+    return -1;
+  }
+
+  return ( a.hi != 0 || a.lo != 0 ) ? 1 : 0;
+}
+
+#endif
+
+} // namespace internal
+
+inline Point2 Integer_grid_kernel::snap( Point2 const& p )
+{
+  if ( step_ == 0.0 )
+  {
+    return p;
+  }
+
+  return Point2( origin_x_ + std::floor( ( p( 0 ) - origin_x_ ) * inv_step_ + 0.5 ) * step_,
+                 origin_y_ + std::floor( ( p( 1 ) - origin_y_ ) * inv_step_ + 0.5 ) * step_ );
+}
+
+// The point is on the grid if it is recovered exactly from its rounded grid
+// coordinates. The origin is a multiple of the spacing, so then the grid
+// coordinates are exactly the offsets from the origin over the spacing.
+inline bool Integer_grid_kernel::to_grid( Point2 const& p, Integer& x, Integer& y )
+{
+  double const max_coordinate = 536870912.0; // 2^29
+
+  double gx = std::floor( ( p( 0 ) - origin_x_ ) * inv_step_ + 0.5 );
+  double gy = std::floor( ( p( 1 ) - origin_y_ ) * inv_step_ + 0.5 );
+
+  if ( !( std::abs( gx ) <= max_coordinate && std::abs( gy ) <= max_coordinate ) ||
+       origin_x_ + gx * step_ != p( 0 ) || origin_y_ + gy * step_ != p( 1 ) )
+  {
+    return false;
+  }
+
+  x = static_cast<Integer>( gx );
+  y = static_cast<Integer>( gy );
+  return true;
+}
+
+// The grid coordinates are at most 2^29 in magnitude, so the differences are
+// at most 2^30, the 2x2 determinants and the lifts at most 2^61 and the
+// incircle determinant below 2^124.
+inline Oriented_side Integer_grid_kernel::oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test )
+{
+  Integer ax, ay, bx, by, cx, cy;
+
+  if ( step_ == 0.0 || !to_grid( pa, ax, ay ) || !to_grid( pb, bx, by ) || !to_grid( test, cx, cy ) )
+  {
+    return Exact_adaptive_kernel::oriented_side( pa, pb, test );
+  }
+
+  Integer det = ( ax - cx ) * ( by - cy ) - ( ay - cy ) * ( bx - cx );
+  return det > 0 ? ON_POSITIVE_SIDE : ( det < 0 ? ON_NEGATIVE_SIDE : ON_ORIENTED_BOUNDARY );
+}
+
+inline Oriented_side Integer_grid_kernel::oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test )
+{
+  Integer ax, ay, bx, by, cx, cy, dx, dy;
+
+  if ( step_ == 0.0 || !to_grid( pa, ax, ay ) || !to_grid( pb, bx, by ) || !to_grid( pc, cx, cy ) || !to_grid( test, dx, dy ) )
+  {
+    return Exact_adaptive_kernel::oriented_circle( pa, pb, pc, test );
+  }
+
+  Integer adx = ax - dx;
+  Integer bdx = bx - dx;
+  Integer cdx = cx - dx;
+  Integer ady = ay - dy;
+  Integer bdy = by - dy;
+  Integer cdy = cy - dy;
+
+  return sign_of_sum_of_products( adx * adx + ady * ady, bdx * cdy - cdx * bdy,
+                                  bdx * bdx + bdy * bdy, cdx * ady - adx * cdy,
+                                  cdx * cdx + cdy * cdy, adx * bdy - bdx * ady );
+}
+
+inline Oriented_side Integer_grid_kernel::sign_of_sum_of_products( Integer a1, Integer b1, Integer a2, Integer b2, Integer a3, Integer b3 )
+{
+  int s = internal::sign( internal::multiply( a1, b1 ) + internal::multiply( a2, b2 ) + internal::multiply( a3, b3 ) );
+  return s > 0 ? ON_POSITIVE_SIDE : ( s < 0 ? ON_NEGATIVE_SIDE : ON_ORIENTED_BOUNDARY );
+}
+
+} // namespace umeshu
+
+#endif // UMESHU_INTEGER_GRID_KERNEL_H
@@ -0,0 +1,142 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+
+#ifndef UMESHU_INTERVAL_H
+#define UMESHU_INTERVAL_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace umeshu
+{
+
+// Closed interval of reals guaranteed to contain the exact result of the
+// arithmetic done on it. The bounds are computed in the default rounding
+// mode and then moved outwards by at least one ulp, which is more than the
+// rounding error of the operation, so no switching of the rounding mode is
+// needed. Overflow gives NaN bounds, which make the interval neither
+// positive nor negative.
+class Interval
+{
+public:
+  Interval( double x )
+    : lo_( x )
+    , hi_( x )
+  {}
+
+  Interval( double lo, double hi )
+    : lo_( lo )
+    , hi_( hi )
+  {}
+
+  double lower() const { return lo_; }
+
+  double upper() const { return hi_; }
+
+  double width() const { return hi_ - lo_; }
+
+  double midpoint() const { return 0.5 * ( lo_ + hi_ ); }
+
+  // whether all the numbers in the interval are positive, resp. negative
+  bool is_positive() const { return lo_ > 0.0; }
+
+  bool is_negative() const { return hi_ < 0.0; }
+
+  friend Interval operator+( Interval const& a, Interval const& b )
+  {
+    return Interval( down( a.lo_ + b.lo_ ), up( a.hi_ + b.hi_ ) );
+  }
+
+  friend Interval operator-( Interval const& a, Interval const& b )
+  {
+    return Interval( down( a.lo_ - b.hi_ ), up( a.hi_ - b.lo_ ) );
+  }
+
+  friend Interval operator*( Interval const& a, Interval const& b )
+  {
+    double p1 = a.lo_ * b.lo_;
+    double p2 = a.lo_ * b.hi_;
+    double p3 = a.hi_ * b.lo_;
+    double p4 = a.hi_ * b.hi_;
+    return Interval( down( std::min( std::min( p1, p2 ), std::min( p3, p4 ) ) ),
+                     up( std::max( std::max( p1, p2 ), std::max( p3, p4 ) ) ) );
+  }
+
+  // The whole line if b contains zero
+  friend Interval operator/( Interval const& a, Interval const& b )
+  {
+    if ( !b.is_positive() && !b.is_negative() )
+    {
+      double const inf = std::numeric_limits<double>::infinity();
+      return Interval( -inf, inf );
+    }
+
+    double q1 = a.lo_ / b.lo_;
+    double q2 = a.lo_ / b.hi_;
+    double q3 = a.hi_ / b.lo_;
+    double q4 = a.hi_ / b.hi_;
+    return Interval( down( std::min( std::min( q1, q2 ), std::min( q3, q4 ) ) ),
+                     up( std::max( std::max( q1, q2 ), std::max( q3, q4 ) ) ) );
+  }
+
+  // Tighter than a * a when the interval contains zero
+  friend Interval square( Interval const& a )
+  {
+    double l = a.lo_ * a.lo_;
+    double h = a.hi_ * a.hi_;
+
+    if ( a.lo_ >= 0.0 )
+    {
+      return Interval( down( l ), up( h ) );
+    }
+
+    if ( a.hi_ <= 0.0 )
+    {
+      return Interval( down( h ), up( l ) );
+    }
+
+    return Interval( 0.0, up( std::max( l, h ) ) );
+  }
+
+private:
+
+  // |x| eps is at least the ulp of x and the smallest subnormal covers the
+  // underflow, so the result is at least one ulp below, resp. above, x.
+  static double down( double x )
+  {
+    return x - ( std::abs( x ) * std::numeric_limits<double>::epsilon() + std::numeric_limits<double>::denorm_min() );
+  }
+
+  static double up( double x )
+  {
+    return x + ( std::abs( x ) * std::numeric_limits<double>::epsilon() + std::numeric_limits<double>::denorm_min() );
+  }
+
+  double lo_;
+  double hi_;
+};
+
+} // namespace umeshu
+
+#endif // UMESHU_INTERVAL_H
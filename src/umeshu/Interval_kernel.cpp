@@ -0,0 +1,71 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+
+#include "Interval_kernel.h"
+#include "Predicates.h"
+
+#include <cmath>
+
+namespace umeshu
+{
+
+Point2 Interval_kernel::circumcenter( Point2 const& p1, Point2 const& p2, Point2 const& p3 )
+{
+  return p1 + circumcenter_offset( p1, p2, p3 );
+}
+
+Point2 Interval_kernel::offcenter( Point2 const& p1, Point2 const& p2, Point2 const& p3, double offconstant )
+{
+  return offcenter_from_circumcenter( p1, p2, p3, circumcenter_offset( p1, p2, p3 ), offconstant );
+}
+
+// The formula is that of Exact_adaptive_kernel::circumcenter. The interval
+// result is accepted if its widths are within 2^-40 of the size of the
+// offset, which covers well-shaped faces at the cost of a few ulps.
+Point2 Interval_kernel::circumcenter_offset( Point2 const& a, Point2 const& b, Point2 const& c )
+{
+  double const relative_tolerance = std::ldexp( 1.0, -40 );
+
+  Interval bax = Interval( b( 0 ) ) - a( 0 );
+  Interval bay = Interval( b( 1 ) ) - a( 1 );
+  Interval cax = Interval( c( 0 ) ) - a( 0 );
+  Interval cay = Interval( c( 1 ) ) - a( 1 );
+  Interval bal = square( bax ) + square( bay );
+  Interval cal = square( cax ) + square( cay );
+  Interval denominator = Interval( 2.0 ) * ( bax * cay - bay * cax );
+  Interval dx = ( cay * bal - bay * cal ) / denominator;
+  Interval dy = ( bax * cal - cax * bal ) / denominator;
+
+  double size = std::abs( dx.midpoint() ) + std::abs( dy.midpoint() );
+
+  if ( dx.width() <= relative_tolerance * size && dy.width() <= relative_tolerance * size )
+  {
+    return Point2( dx.midpoint(), dy.midpoint() );
+  }
+
+  Point2 offset;
+  circumcenter_exact( a.data(), b.data(), c.data(), offset.data() );
+  return offset;
+}
+
+} // namespace umeshu
@@ -0,0 +1,98 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+
+#ifndef UMESHU_INTERVAL_KERNEL_H
+#define UMESHU_INTERVAL_KERNEL_H
+
+#include "Exact_adaptive_kernel.h"
+#include "Interval.h"
+
+namespace umeshu
+{
+
+// Kernel that evaluates the determinants of the predicates in interval
+// arithmetic and decides by the sign of the interval; only when it contains
+// zero the query goes to the adaptive predicates of Exact_adaptive_kernel.
+// The circumcenter and the off-center are filtered in the same way: the
+// offset of the circumcenter is computed in interval arithmetic and used if
+// the intervals are narrow, otherwise it is computed from exact expansions.
+// Either way it is within a few ulps of the exact one, also for nearly
+// collinear points, for which the plain floating-point formula can put it
+// far from the true circumcenter.
+struct Interval_kernel : public Exact_adaptive_kernel
+{
+  static Oriented_side oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test );
+  static Oriented_side oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test );
+
+  static Point2 circumcenter( Point2 const& p1, Point2 const& p2, Point2 const& p3 );
+  static Point2 offcenter( Point2 const& p1, Point2 const& p2, Point2 const& p3, double offconstant );
+
+private:
+
+  static Point2 circumcenter_offset( Point2 const& a, Point2 const& b, Point2 const& c );
+
+  static Oriented_side sign( Interval const& det )
+  {
+    return det.is_positive() ? ON_POSITIVE_SIDE : ON_NEGATIVE_SIDE;
+  }
+};
+
+inline Oriented_side Interval_kernel::oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test )
+{
+  Interval acx = Interval( pa( 0 ) ) - test( 0 );
+  Interval bcx = Interval( pb( 0 ) ) - test( 0 );
+  Interval acy = Interval( pa( 1 ) ) - test( 1 );
+  Interval bcy = Interval( pb( 1 ) ) - test( 1 );
+  Interval det = acx * bcy - acy * bcx;
+
+  if ( det.is_positive() || det.is_negative() )
+  {
+    return sign( det );
+  }
+
+  return Exact_adaptive_kernel::oriented_side( pa, pb, test );
+}
+
+inline Oriented_side Interval_kernel::oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test )
+{
+  Interval adx = Interval( pa( 0 ) ) - test( 0 );
+  Interval bdx = Interval( pb( 0 ) ) - test( 0 );
+  Interval cdx = Interval( pc( 0 ) ) - test( 0 );
+  Interval ady = Interval( pa( 1 ) ) - test( 1 );
+  Interval bdy = Interval( pb( 1 ) ) - test( 1 );
+  Interval cdy = Interval( pc( 1 ) ) - test( 1 );
+  Interval det = ( square( adx ) + square( ady ) ) * ( bdx * cdy - cdx * bdy )
+               + ( square( bdx ) + square( bdy ) ) * ( cdx * ady - adx * cdy )
+               + ( square( cdx ) + square( cdy ) ) * ( adx * bdy - bdx * ady );
+
+  if ( det.is_positive() || det.is_negative() )
+  {
+    return sign( det );
+  }
+
+  return Exact_adaptive_kernel::oriented_circle( pa, pb, pc, test );
+}
+
+} // namespace umeshu
+
+#endif // UMESHU_INTERVAL_KERNEL_H
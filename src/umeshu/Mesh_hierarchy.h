@@ -0,0 +1,380 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+
+#ifndef UMESHU_MESH_HIERARCHY_H
+#define UMESHU_MESH_HIERARCHY_H
+
+#include "Point2.h"
+#include "Triangulation.h"
+
+#include <boost/assert.hpp>
+#include <boost/unordered/unordered_map.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace umeshu
+{
+
+// Record of the levels of a triangulation refined in place, as done by
+// Delaunay_mesher::refine_levels. The nodes are numbered in the order of the
+// node list of the triangulation and, since the refinement only appends
+// nodes, the nodes of a level are those numbered below its watermark and
+// each level keeps only its faces as triples of node numbers. Every node
+// added after the first level gets its parent, the face of the previous level
+// containing it, with the barycentric coordinates of the node in that face,
+// i.e., the weights of the linear interpolation from the coarser level.
+template <typename Triangulation>
+class Mesh_hierarchy
+{
+public:
+  typedef          Triangulation             Tria;
+  typedef typename Tria::Kernel              Kernel;
+  typedef typename Tria::Node                Node;
+  typedef typename Tria::Node_handle         Node_handle;
+  typedef typename Tria::Node_const_iterator Node_const_iterator;
+  typedef typename Tria::Face_const_iterator Face_const_iterator;
+
+  struct Parent
+  {
+    std::size_t face;
+    std::size_t nodes[3];
+    double      weights[3];
+  };
+
+  void clear()
+  {
+    positions_.clear();
+    num_nodes_.clear();
+    faces_.clear();
+    parents_.clear();
+  }
+
+  std::size_t number_of_levels() const { return num_nodes_.size(); }
+
+  std::size_t number_of_nodes( std::size_t level ) const { return num_nodes_[level]; }
+
+  std::size_t number_of_faces( std::size_t level ) const { return faces_[level].size() / 3; }
+
+  // Node numbers of the faces of the level, three per face in
+  // counter-clockwise order.
+  std::vector<std::size_t> const& faces( std::size_t level ) const { return faces_[level]; }
+
+  Point2 const& position( std::size_t node ) const { return positions_[node]; }
+
+  Parent const& parent( std::size_t node ) const
+  {
+    BOOST_ASSERT( node >= num_nodes_[0] );
+    return parents_[node - num_nodes_[0]];
+  }
+
+  void add_level( Tria const& tria );
+
+private:
+
+  typedef boost::unordered_map<Node const*, std::size_t>                         Node_numbers;
+  typedef boost::unordered_map<std::pair<std::size_t, std::size_t>, std::size_t> Face_edges;
+
+  bool walk( std::size_t level, std::vector<std::size_t> const& neighbours, Point2 const& p, std::size_t& face ) const;
+  std::size_t scan( std::size_t level, Point2 const& p ) const;
+  void set_parent( std::size_t node, std::vector<std::size_t> const& coarse, std::size_t face );
+  bool contains( std::size_t level, std::size_t face, Point2 const& p ) const;
+  static bool is_on_boundary_edge( Point2 const& p, Point2 const& p1, Point2 const& p2 );
+
+  std::vector<Point2>                     positions_;
+  std::vector<std::size_t>                num_nodes_;
+  std::vector< std::vector<std::size_t> > faces_;
+  std::vector<Parent>                     parents_;
+};
+
+template <typename Triangulation>
+void Mesh_hierarchy<Triangulation>::add_level( Tria const& tria )
+{
+  std::size_t first_new = positions_.size();
+  BOOST_ASSERT( tria.number_of_nodes() >= first_new );
+
+  Node_numbers numbers;
+  std::vector<Node const*> new_nodes;
+  std::size_t n = 0;
+
+  for ( Node_const_iterator iter = tria.nodes_begin(); iter != tria.nodes_end(); ++iter, ++n )
+  {
+    numbers[&*iter] = n;
+
+    if ( n >= first_new )
+    {
+      positions_.push_back( iter->position() );
+      new_nodes.push_back( &*iter );
+    }
+  }
+
+  std::vector<std::size_t> faces;
+  faces.reserve( 3 * tria.number_of_faces() );
+
+  for ( Face_const_iterator iter = tria.faces_begin(); iter != tria.faces_end(); ++iter )
+  {
+    Node_handle n1, n2, n3;
+    iter->nodes( n1, n2, n3 );
+    faces.push_back( numbers[&*n1] );
+    faces.push_back( numbers[&*n2] );
+    faces.push_back( numbers[&*n3] );
+  }
+
+  std::size_t level = num_nodes_.size();
+  num_nodes_.push_back( positions_.size() );
+  faces_.push_back( std::vector<std::size_t>() );
+  faces_.back().swap( faces );
+
+  if ( level == 0 )
+  {
+    return;
+  }
+
+  // neighbours of the faces of the previous level, across the edge starting
+  // at each of their nodes
+  std::vector<std::size_t> const& coarse = faces_[level - 1];
+  std::size_t no_face = coarse.size();
+  std::vector<std::size_t> neighbours( coarse.size(), no_face );
+  Face_edges edges;
+
+  for ( std::size_t i = 0; i < coarse.size(); ++i )
+  {
+    std::size_t j = i % 3 == 2 ? i - 2 : i + 1;
+    edges[std::make_pair( coarse[i], coarse[j] )] = i / 3;
+  }
+
+  for ( std::size_t i = 0; i < coarse.size(); ++i )
+  {
+    std::size_t j = i % 3 == 2 ? i - 2 : i + 1;
+    typename Face_edges::const_iterator iter = edges.find( std::make_pair( coarse[j], coarse[i] ) );
+
+    if ( iter != edges.end() )
+    {
+      neighbours[i] = iter->second;
+    }
+  }
+
+  std::vector<std::size_t> incident_faces( first_new );
+
+  for ( std::size_t i = 0; i < coarse.size(); ++i )
+  {
+    incident_faces[coarse[i]] = i / 3;
+  }
+
+  // The walks start next to the neighbours of the node that are either nodes
+  // of the previous level or have been located already. Nodes with no such
+  // neighbour wait for the next pass, unless the last pass did not locate
+  // any node. Around a reentrant corner a walk can run into the boundary, so
+  // all the neighbours are tried before scanning the faces.
+  parents_.resize( positions_.size() - num_nodes_[0] );
+  std::vector<bool> located( positions_.size() - first_new, false );
+  std::vector<std::size_t> pending, deferred;
+
+  for ( std::size_t node = first_new; node < positions_.size(); ++node )
+  {
+    pending.push_back( node );
+  }
+
+  std::size_t face = 0;
+  bool progress = true;
+
+  while ( !pending.empty() )
+  {
+    deferred.clear();
+
+    for ( std::size_t k = 0; k < pending.size(); ++k )
+    {
+      std::size_t node = pending[k];
+      Point2 const& p = positions_[node];
+      typename Tria::Halfedge_handle he_start = new_nodes[node - first_new]->halfedge();
+      typename Tria::Halfedge_handle he = he_start;
+      bool seeded = false;
+      bool found = false;
+
+      do
+      {
+        std::size_t m = numbers[&*he->pair()->origin()];
+
+        if ( m < first_new || located[m - first_new] )
+        {
+          face = m < first_new ? incident_faces[m] : parents_[m - num_nodes_[0]].face;
+          seeded = true;
+          found = walk( level - 1, neighbours, p, face );
+        }
+
+        he = he->pair()->next();
+      }
+      while ( !found && he != he_start );
+
+      if ( !seeded && progress )
+      {
+        deferred.push_back( node );
+        continue;
+      }
+
+      if ( !found )
+      {
+        face = scan( level - 1, p );
+      }
+
+      set_parent( node, coarse, face );
+      located[node - first_new] = true;
+    }
+
+    progress = deferred.size() < pending.size();
+    pending.swap( deferred );
+  }
+}
+
+template <typename Triangulation>
+void Mesh_hierarchy<Triangulation>::set_parent( std::size_t node, std::vector<std::size_t> const& coarse, std::size_t face )
+{
+  Point2 const& p = positions_[node];
+  Parent& parent = parents_[node - num_nodes_[0]];
+  parent.face = face;
+  Point2 q[3];
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    parent.nodes[i] = coarse[3 * face + i];
+    q[i] = positions_[parent.nodes[i]];
+  }
+
+  double area = Kernel::signed_area( q[0], q[1], q[2] );
+  parent.weights[0] = Kernel::signed_area( p, q[1], q[2] ) / area;
+  parent.weights[1] = Kernel::signed_area( q[0], p, q[2] ) / area;
+  parent.weights[2] = 1.0 - parent.weights[0] - parent.weights[1];
+}
+
+// Walks from the given face towards p. Fails when it runs into the boundary,
+// which in a non-convex domain need not mean that p is outside, or when it
+// takes too long.
+template <typename Triangulation>
+bool Mesh_hierarchy<Triangulation>::walk( std::size_t level, std::vector<std::size_t> const& neighbours, Point2 const& p, std::size_t& face ) const
+{
+  std::vector<std::size_t> const& faces = faces_[level];
+  std::size_t num_faces = faces.size() / 3;
+
+  for ( std::size_t steps = 0; steps < num_faces; ++steps )
+  {
+    std::size_t next = face;
+    bool on_boundary = false;
+
+    for ( std::size_t i = 3 * face; i < 3 * face + 3; ++i )
+    {
+      std::size_t j = i % 3 == 2 ? i - 2 : i + 1;
+      Point2 const& p1 = positions_[faces[i]];
+      Point2 const& p2 = positions_[faces[j]];
+
+      if ( Kernel::oriented_side( p1, p2, p ) == ON_NEGATIVE_SIDE )
+      {
+        if ( neighbours[i] != faces.size() )
+        {
+          next = neighbours[i];
+          break;
+        }
+
+        on_boundary = on_boundary || is_on_boundary_edge( p, p1, p2 );
+        next = faces.size();
+      }
+    }
+
+    if ( next == face || ( next == faces.size() && on_boundary ) )
+    {
+      return true;
+    }
+    else if ( next == faces.size() )
+    {
+      return false;
+    }
+
+    face = next;
+  }
+
+  return false;
+}
+
+// When no face contains p, the face it is the least outside of is taken.
+template <typename Triangulation>
+std::size_t Mesh_hierarchy<Triangulation>::scan( std::size_t level, Point2 const& p ) const
+{
+  std::vector<std::size_t> const& faces = faces_[level];
+  std::size_t num_faces = faces.size() / 3;
+  std::size_t best = 0;
+  double best_distance = -std::numeric_limits<double>::max();
+
+  for ( std::size_t face = 0; face < num_faces; ++face )
+  {
+    double distance = std::numeric_limits<double>::max();
+
+    for ( std::size_t i = 3 * face; i < 3 * face + 3; ++i )
+    {
+      std::size_t j = i % 3 == 2 ? i - 2 : i + 1;
+      Point2 const& p1 = positions_[faces[i]];
+      Point2 const& p2 = positions_[faces[j]];
+      distance = std::min( distance, 2.0 * Kernel::signed_area( p1, p2, p ) / Kernel::distance( p1, p2 ) );
+    }
+
+    if ( distance >= 0.0 && contains( level, face, p ) )
+    {
+      return face;
+    }
+    else if ( distance > best_distance )
+    {
+      best = face;
+      best_distance = distance;
+    }
+  }
+
+  return best;
+}
+
+template <typename Triangulation>
+bool Mesh_hierarchy<Triangulation>::contains( std::size_t level, std::size_t face, Point2 const& p ) const
+{
+  std::vector<std::size_t> const& faces = faces_[level];
+  Point2 const& p1 = positions_[faces[3 * face]];
+  Point2 const& p2 = positions_[faces[3 * face + 1]];
+  Point2 const& p3 = positions_[faces[3 * face + 2]];
+  return Kernel::oriented_side( p1, p2, p ) != ON_NEGATIVE_SIDE &&
+         Kernel::oriented_side( p2, p3, p ) != ON_NEGATIVE_SIDE &&
+         Kernel::oriented_side( p3, p1, p ) != ON_NEGATIVE_SIDE;
+}
+
+// Nodes splitting boundary edges may be off them by rounding errors.
+template <typename Triangulation>
+bool Mesh_hierarchy<Triangulation>::is_on_boundary_edge( Point2 const& p, Point2 const& p1, Point2 const& p2 )
+{
+  Point2 d = p2 - p1;
+  double l2 = d.squaredNorm();
+  double t = d.dot( p - p1 );
+  return 0.0 <= t && t <= l2 && std::abs( 2.0 * Kernel::signed_area( p1, p2, p ) ) <= 1e-12 * l2;
+}
+
+} // namespace umeshu
+
+#endif // UMESHU_MESH_HIERARCHY_H
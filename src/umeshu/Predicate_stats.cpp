@@ -0,0 +1,132 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+
+#include "Predicate_stats.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace umeshu
+{
+
+namespace
+{
+
+// The counts of the running threads which have evaluated a predicate, and
+// the sum of the counts of the finished ones
+boost::mutex registry_mutex;
+std::vector<Predicate_stats*> registry;
+Predicate_stats retired;
+
+// Called at the end of a thread, which adds its counts to those of the
+// finished threads and frees them, so that the registry holds only the
+// running threads however many have been started
+void retire_predicate_stats( Predicate_stats* stats )
+{
+  {
+    boost::mutex::scoped_lock lock( registry_mutex );
+    retired += *stats;
+    registry.erase( std::find( registry.begin(), registry.end(), stats ) );
+  }
+
+#ifdef __GNUC__
+  internal::thread_predicate_stats_ = 0;
+#endif
+
+  delete stats;
+}
+
+boost::thread_specific_ptr<Predicate_stats> thread_stats( &retire_predicate_stats );
+
+} // namespace
+
+namespace internal
+{
+
+Predicate_stats& register_thread_predicate_stats()
+{
+  Predicate_stats* stats = new Predicate_stats;
+  thread_stats.reset( stats );
+  boost::mutex::scoped_lock lock( registry_mutex );
+  registry.push_back( stats );
+  return *stats;
+}
+
+#ifdef __GNUC__
+
+__thread Predicate_stats* thread_predicate_stats_ = 0;
+
+#else
+
+Predicate_stats& thread_predicate_stats()
+{
+  if ( thread_stats.get() == 0 )
+  {
+    return register_thread_predicate_stats();
+  }
+
+  return *thread_stats;
+}
+
+#endif
+
+} // namespace internal
+
+bool predicate_stats_enabled()
+{
+#ifdef UMESHU_PREDICATE_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+Predicate_stats predicate_stats()
+{
+  boost::mutex::scoped_lock lock( registry_mutex );
+  Predicate_stats sum = retired;
+
+  for ( std::size_t i = 0; i < registry.size(); ++i )
+  {
+    sum += *registry[i];
+  }
+
+  return sum;
+}
+
+void reset_predicate_stats()
+{
+  boost::mutex::scoped_lock lock( registry_mutex );
+  retired = Predicate_stats();
+
+  for ( std::size_t i = 0; i < registry.size(); ++i )
+  {
+    *registry[i] = Predicate_stats();
+  }
+}
+
+} // namespace umeshu
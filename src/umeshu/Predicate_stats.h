@@ -0,0 +1,123 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+
+#ifndef UMESHU_PREDICATE_STATS_H
+#define UMESHU_PREDICATE_STATS_H
+
+#include "Config.h"
+
+namespace umeshu
+{
+
+// Numbers of calls of a predicate of Predicates.cpp and of the calls which
+// reached its adaptive stages B and C and its exact stage D. The others were
+// decided by the floating-point filter (stage A).
+struct Predicate_counts
+{
+  Predicate_counts()
+    : calls( 0 )
+    , stage_b( 0 )
+    , stage_c( 0 )
+    , exact( 0 )
+  {}
+
+  unsigned long filtered() const { return calls - stage_b; }
+
+  Predicate_counts& operator+=( Predicate_counts const& c )
+  {
+    calls += c.calls;
+    stage_b += c.stage_b;
+    stage_c += c.stage_c;
+    exact += c.exact;
+    return *this;
+  }
+
+  unsigned long calls;
+  unsigned long stage_b;
+  unsigned long stage_c;
+  unsigned long exact;
+};
+
+struct Predicate_stats
+{
+  Predicate_stats& operator+=( Predicate_stats const& s )
+  {
+    orient2d += s.orient2d;
+    incircle += s.incircle;
+    return *this;
+  }
+
+  Predicate_counts orient2d;
+  Predicate_counts incircle;
+};
+
+// Whether the library counts the calls, i.e., was configured with the
+// UMESHU_PREDICATE_STATS option, which Config.h records for the inline
+// predicates of Predicates.h. Otherwise the counts stay zero.
+bool predicate_stats_enabled();
+
+// The counts of all threads since the last reset, including the finished
+// ones. Each thread counts on its own, so the counts are exact only if no
+// predicates are being evaluated during the call.
+Predicate_stats predicate_stats();
+
+void reset_predicate_stats();
+
+namespace internal
+{
+
+Predicate_stats& register_thread_predicate_stats();
+
+#ifdef __GNUC__
+
+extern __thread Predicate_stats* thread_predicate_stats_;
+
+inline Predicate_stats& thread_predicate_stats()
+{
+  if ( thread_predicate_stats_ == 0 )
+  {
+    thread_predicate_stats_ = &register_thread_predicate_stats();
+  }
+
+  return *thread_predicate_stats_;
+}
+
+#else
+
+Predicate_stats& thread_predicate_stats();
+
+#endif
+
+} // namespace internal
+
+} // namespace umeshu
+
+// Counts a call of the predicate reaching the stage, in the counts of the
+// calling thread; nothing unless UMESHU_PREDICATE_STATS is defined.
+#ifdef UMESHU_PREDICATE_STATS
+#define UMESHU_COUNT_PREDICATE( predicate, stage ) ( ++umeshu::internal::thread_predicate_stats().predicate.stage )
+#else
+#define UMESHU_COUNT_PREDICATE( predicate, stage ) ( (void) 0 )
+#endif
+
+#endif // UMESHU_PREDICATE_STATS_H
@@ -119,6 +119,7 @@
 // #include <sys/time.h>
 
 // #include "Predicates.h"
+#include "Predicate_stats.h"
 
 /* On some machines, the exact arithmetic routines might be defeated by the  */
 /*   use of internal extended precision floating-point registers.  Sometimes */
@@ -1493,6 +1494,8 @@ REAL orient2dadapt(REAL const* pa, REAL const* pb, REAL const* pc, REAL detsum)
   INEXACT REAL _i, _j;
   REAL _0;
 
+  UMESHU_COUNT_PREDICATE(orient2d, stage_b);
+
   acx = (REAL) (pa[0] - pc[0]);
   bcx = (REAL) (pb[0] - pc[0]);
   acy = (REAL) (pa[1] - pc[1]);
@@ -1511,6 +1514,8 @@ REAL orient2dadapt(REAL const* pa, REAL const* pb, REAL const* pc, REAL detsum)
     return det;
   }
 
+  UMESHU_COUNT_PREDICATE(orient2d, stage_c);
+
   Two_Diff_Tail(pa[0], pc[0], acx, acxtail);
   Two_Diff_Tail(pb[0], pc[0], bcx, bcxtail);
   Two_Diff_Tail(pa[1], pc[1], acy, acytail);
@@ -1528,6 +1533,8 @@ REAL orient2dadapt(REAL const* pa, REAL const* pb, REAL const* pc, REAL detsum)
     return det;
   }
 
+  UMESHU_COUNT_PREDICATE(orient2d, exact);
+
   Two_Product(acxtail, bcy, s1, s0);
   Two_Product(acytail, bcx, t1, t0);
   Two_Two_Diff(s1, s0, t1, t0, u3, u[2], u[1], u[0]);
@@ -1549,38 +1556,8 @@ REAL orient2dadapt(REAL const* pa, REAL const* pb, REAL const* pc, REAL detsum)
   return(D[Dlength - 1]);
 }
 
-REAL orient2d(REAL const* pa, REAL const* pb, REAL const* pc)
-{
-  REAL detleft, detright, det;
-  REAL detsum, errbound;
-
-  detleft = (pa[0] - pc[0]) * (pb[1] - pc[1]);
-  detright = (pa[1] - pc[1]) * (pb[0] - pc[0]);
-  det = detleft - detright;
-
-  if (detleft > 0.0) {
-    if (detright <= 0.0) {
-      return det;
-    } else {
-      detsum = detleft + detright;
-    }
-  } else if (detleft < 0.0) {
-    if (detright >= 0.0) {
-      return det;
-    } else {
-      detsum = -detleft - detright;
-    }
-  } else {
-    return det;
-  }
-
-  errbound = ccwerrboundA * detsum;
-  if ((det >= errbound) || (-det >= errbound)) {
-    return det;
-  }
-
-  return orient2dadapt(pa, pb, pc, detsum);
-}
+/* orient2d() is defined inline in Predicates.h, so that the calls decided */
+/*   by its first stage are not calls into this translation unit.         */
 
 /*****************************************************************************/
 /*                                                                           */
@@ -2608,6 +2585,8 @@ REAL incircleadapt(REAL const* pa, REAL const* pb, REAL const* pc, REAL const* p
   INEXACT REAL _i, _j;
   REAL _0;
 
+  UMESHU_COUNT_PREDICATE(incircle, stage_b);
+
   adx = (REAL) (pa[0] - pd[0]);
   bdx = (REAL) (pb[0] - pd[0]);
   cdx = (REAL) (pc[0] - pd[0]);
@@ -2654,6 +2633,8 @@ REAL incircleadapt(REAL const* pa, REAL const* pb, REAL const* pc, REAL const* p
     return det;
   }
 
+  UMESHU_COUNT_PREDICATE(incircle, stage_c);
+
   Two_Diff_Tail(pa[0], pd[0], adx, adxtail);
   Two_Diff_Tail(pa[1], pd[1], ady, adytail);
   Two_Diff_Tail(pb[0], pd[0], bdx, bdxtail);
@@ -2679,6 +2660,8 @@ REAL incircleadapt(REAL const* pa, REAL const* pb, REAL const* pc, REAL const* p
     return det;
   }
 
+  UMESHU_COUNT_PREDICATE(incircle, exact);
+
   finnow = fin1;
   finother = fin2;
 
@@ -3114,47 +3097,7 @@ REAL incircleadapt(REAL const* pa, REAL const* pb, REAL const* pc, REAL const* p
   return finnow[finlength - 1];
 }
 
-REAL incircle(REAL const* pa, REAL const* pb, REAL const* pc, REAL const* pd)
-{
-  REAL adx, bdx, cdx, ady, bdy, cdy;
-  REAL bdxcdy, cdxbdy, cdxady, adxcdy, adxbdy, bdxady;
-  REAL alift, blift, clift;
-  REAL det;
-  REAL permanent, errbound;
-
-  adx = pa[0] - pd[0];
-  bdx = pb[0] - pd[0];
-  cdx = pc[0] - pd[0];
-  ady = pa[1] - pd[1];
-  bdy = pb[1] - pd[1];
-  cdy = pc[1] - pd[1];
-
-  bdxcdy = bdx * cdy;
-  cdxbdy = cdx * bdy;
-  alift = adx * adx + ady * ady;
-
-  cdxady = cdx * ady;
-  adxcdy = adx * cdy;
-  blift = bdx * bdx + bdy * bdy;
-
-  adxbdy = adx * bdy;
-  bdxady = bdx * ady;
-  clift = cdx * cdx + cdy * cdy;
-
-  det = alift * (bdxcdy - cdxbdy)
-      + blift * (cdxady - adxcdy)
-      + clift * (adxbdy - bdxady);
-
-  permanent = (Absolute(bdxcdy) + Absolute(cdxbdy)) * alift
-            + (Absolute(cdxady) + Absolute(adxcdy)) * blift
-            + (Absolute(adxbdy) + Absolute(bdxady)) * clift;
-  errbound = iccerrboundA * permanent;
-  if ((det > errbound) || (-det > errbound)) {
-    return det;
-  }
-
-  return incircleadapt(pa, pb, pc, pd, permanent);
-}
+/* incircle() is defined inline in Predicates.h.                           */
 
 /*****************************************************************************/
 /*                                                                           */
@@ -4122,3 +4065,87 @@ REAL insphere(REAL const* pa, REAL const* pb, REAL const* pc, REAL const* pd, RE
 
   return insphereadapt(pa, pb, pc, pd, pe, permanent);
 }
+
+/*****************************************************************************/
+/*                                                                           */
+/*  circumcenter_exact()   Offset of the circumcenter of pa, pb, pc from pa, */
+/*                         rounded from exact expansions.                    */
+/*                                                                           */
+/*               With b = pb - pa and c = pc - pa, the offset is             */
+/*                                                                           */
+/*                   ( c.y |b|^2 - b.y |c|^2,  b.x |c|^2 - c.x |b|^2 )       */
+/*                   -------------------------------------------------       */
+/*                                2 (b.x c.y - b.y c.x)                      */
+/*                                                                           */
+/*  The differences are formed exactly as two-component expansions, and     */
+/*  the numerators and the denominator are computed exactly from them.  The  */
+/*  only roundings are in the approximations of the expansions and in the    */
+/*  final division, so the offset has a relative error of a few ulps in      */
+/*  each coordinate however close to collinear the points are.  The offset   */
+/*  is infinite or NaN for collinear points.                                 */
+/*                                                                           */
+/*****************************************************************************/
+
+/* h = e * f, with f of two components; h needs room for 4 * elen. */
+static int two_component_product(int elen, REAL *e, REAL *f, REAL *h)
+{
+  REAL e0[32], e1[32];
+  int e0len, e1len;
+
+  e0len = scale_expansion_zeroelim(elen, e, f[0], e0);
+  e1len = scale_expansion_zeroelim(elen, e, f[1], e1);
+  return fast_expansion_sum_zeroelim(e0len, e0, e1len, e1, h);
+}
+
+/* h = e * e' + f * f', all four of two components; h needs room for 16. */
+static int two_by_two_sum(REAL *e, REAL *ep, REAL *f, REAL *fp, REAL *h)
+{
+  REAL p[8], q[8];
+  int plen, qlen;
+
+  plen = two_component_product(2, e, ep, p);
+  qlen = two_component_product(2, f, fp, q);
+  return fast_expansion_sum_zeroelim(plen, p, qlen, q, h);
+}
+
+void circumcenter_exact(REAL const *pa, REAL const *pb, REAL const *pc,
+                        REAL *offset)
+{
+  INEXACT REAL bvirt;
+  REAL avirt, bround, around;
+  REAL bx[2], by[2], cx[2], cy[2];
+  REAL ncx[2];
+  REAL blift[16], clift[16], det[16];
+  REAL p[64], q[64], xnum[128], ynum[128];
+  REAL denominator;
+  int bliftlen, cliftlen, detlen, plen, qlen, xnumlen, ynumlen;
+  int i;
+
+  Two_Diff(pb[0], pa[0], bx[1], bx[0]);
+  Two_Diff(pb[1], pa[1], by[1], by[0]);
+  Two_Diff(pc[0], pa[0], cx[1], cx[0]);
+  Two_Diff(pc[1], pa[1], cy[1], cy[0]);
+  ncx[0] = -cx[0];
+  ncx[1] = -cx[1];
+
+  bliftlen = two_by_two_sum(bx, bx, by, by, blift);
+  cliftlen = two_by_two_sum(cx, cx, cy, cy, clift);
+  detlen = two_by_two_sum(bx, cy, ncx, by, det);
+
+  /* c.y |b|^2 - b.y |c|^2 */
+  plen = two_component_product(bliftlen, blift, cy, p);
+  qlen = two_component_product(cliftlen, clift, by, q);
+  for (i = 0; i < qlen; i++) {
+    q[i] = -q[i];
+  }
+  xnumlen = fast_expansion_sum_zeroelim(plen, p, qlen, q, xnum);
+
+  /* b.x |c|^2 - c.x |b|^2 */
+  plen = two_component_product(cliftlen, clift, bx, p);
+  qlen = two_component_product(bliftlen, blift, ncx, q);
+  ynumlen = fast_expansion_sum_zeroelim(plen, p, qlen, q, ynum);
+
+  denominator = 2.0 * estimate(detlen, det);
+  offset[0] = estimate(xnumlen, xnum) / denominator;
+  offset[1] = estimate(ynumlen, ynum) / denominator;
+}
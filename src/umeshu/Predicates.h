@@ -22,16 +22,102 @@
 #ifndef UMESHU_PREDICATES_H
 #define UMESHU_PREDICATES_H
 
+#include "Predicate_stats.h"
+
+#include <cmath>
+
 double orient2dfast(double const* pa, double const* pb, double const* pc);
-double orient2d(double const* pa, double const* pb, double const* pc);
+double orient2dadapt(double const* pa, double const* pb, double const* pc, double detsum);
 
 double orient3dfast(double const* pa, double const* pb, double const* pc, double const* pd );
 double orient3d(double const* pa, double const* pb, double const* pc, double const* pd );
 
 double incirclefast(double const* pa, double const* pb, double const* pc, double const* pd);
-double incircle(double const* pa, double const* pb, double const* pc, double const* pd);
+double incircleadapt(double const* pa, double const* pb, double const* pc, double const* pd, double permanent);
+
+// offset of the circumcenter of pa, pb, pc from pa, computed exactly and rounded
+void circumcenter_exact(double const* pa, double const* pb, double const* pc, double* offset);
 
 double inspherefast(double const* pa, double const* pb, double const* pc, double const* pd, double const* pe );
 double insphere(double const* pa, double const* pb, double const* pc, double const* pd, double const* pe );
 
+// error bounds of the first stages, set by exactinit()
+extern double ccwerrboundA;
+extern double iccerrboundA;
+
+// The first stages of orient2d and incircle are defined here, so that they
+// are inlined into the callers and only the rare calls that need the
+// adaptive stages leave the caller's translation unit.
+
+inline double orient2d(double const* pa, double const* pb, double const* pc)
+{
+  UMESHU_COUNT_PREDICATE(orient2d, calls);
+
+  double detleft = (pa[0] - pc[0]) * (pb[1] - pc[1]);
+  double detright = (pa[1] - pc[1]) * (pb[0] - pc[0]);
+  double det = detleft - detright;
+  double detsum;
+
+  if (detleft > 0.0) {
+    if (detright <= 0.0) {
+      return det;
+    } else {
+      detsum = detleft + detright;
+    }
+  } else if (detleft < 0.0) {
+    if (detright >= 0.0) {
+      return det;
+    } else {
+      detsum = -detleft - detright;
+    }
+  } else {
+    return det;
+  }
+
+  double errbound = ccwerrboundA * detsum;
+  if ((det >= errbound) || (-det >= errbound)) {
+    return det;
+  }
+
+  return orient2dadapt(pa, pb, pc, detsum);
+}
+
+inline double incircle(double const* pa, double const* pb, double const* pc, double const* pd)
+{
+  UMESHU_COUNT_PREDICATE(incircle, calls);
+
+  double adx = pa[0] - pd[0];
+  double bdx = pb[0] - pd[0];
+  double cdx = pc[0] - pd[0];
+  double ady = pa[1] - pd[1];
+  double bdy = pb[1] - pd[1];
+  double cdy = pc[1] - pd[1];
+
+  double bdxcdy = bdx * cdy;
+  double cdxbdy = cdx * bdy;
+  double alift = adx * adx + ady * ady;
+
+  double cdxady = cdx * ady;
+  double adxcdy = adx * cdy;
+  double blift = bdx * bdx + bdy * bdy;
+
+  double adxbdy = adx * bdy;
+  double bdxady = bdx * ady;
+  double clift = cdx * cdx + cdy * cdy;
+
+  double det = alift * (bdxcdy - cdxbdy)
+             + blift * (cdxady - adxcdy)
+             + clift * (adxbdy - bdxady);
+
+  double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * alift
+                   + (std::fabs(cdxady) + std::fabs(adxcdy)) * blift
+                   + (std::fabs(adxbdy) + std::fabs(bdxady)) * clift;
+  double errbound = iccerrboundA * permanent;
+  if ((det > errbound) || (-det > errbound)) {
+    return det;
+  }
+
+  return incircleadapt(pa, pb, pc, pd, permanent);
+}
+
 #endif // UMESHU_PREDICATES_H
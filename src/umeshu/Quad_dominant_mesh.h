@@ -0,0 +1,320 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+#ifndef UMESHU_QUAD_DOMINANT_MESH_H
+#define UMESHU_QUAD_DOMINANT_MESH_H
+
+#include "Point2.h"
+#include "Triangulation.h"
+
+#include <boost/assert.hpp>
+#include <boost/unordered/unordered_map.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace umeshu
+{
+
+// Mesh of triangles and quadrilaterals made from a triangulation by merging
+// pairs of adjacent faces. Each interior edge that is not constrained and is
+// the diagonal of a convex quadrilateral is a candidate for the merge,
+// weighted by the quality of the quadrilateral, i.e., one minus the largest
+// deviation of its angles from the right angle relative to the right angle.
+// The candidates are taken greedily from the best one, which yields a
+// matching of at least half the maximum weight in O(n log n) time. The
+// elements can then be split into quadrilaterals only, each by joining its
+// centroid with the midpoints of its edges. The nodes are numbered in the
+// order of the node list of the triangulation, the new nodes follow.
+template <typename Triangulation>
+class Quad_dominant_mesh
+{
+public:
+  typedef          Triangulation             Tria;
+  typedef typename Tria::Node                Node;
+  typedef typename Tria::Face                Face;
+  typedef typename Tria::Node_handle         Node_handle;
+  typedef typename Tria::Halfedge_handle     Halfedge_handle;
+  typedef typename Tria::Node_const_iterator Node_const_iterator;
+  typedef typename Tria::Edge_const_iterator Edge_const_iterator;
+  typedef typename Tria::Face_const_iterator Face_const_iterator;
+
+  Quad_dominant_mesh()
+    : offsets_( 1, 0 )
+    , num_edges_( 0 )
+  {}
+
+  void clear()
+  {
+    positions_.clear();
+    offsets_.assign( 1, 0 );
+    nodes_.clear();
+    num_edges_ = 0;
+  }
+
+  // Quadrilaterals of quality below min_quality are not formed.
+  void pair_triangles( Tria const& tria, double min_quality = 0.0 );
+
+  void split_into_quads();
+
+  std::size_t number_of_nodes() const { return positions_.size(); }
+
+  std::size_t number_of_edges() const { return num_edges_; }
+
+  std::size_t number_of_elements() const { return offsets_.size() - 1; }
+
+  std::size_t number_of_quads() const { return nodes_.size() - 3 * number_of_elements(); }
+
+  std::size_t number_of_triangles() const { return number_of_elements() - number_of_quads(); }
+
+  Point2 const& position( std::size_t node ) const { return positions_[node]; }
+
+  // Number of nodes of the element, three or four
+  std::size_t element_size( std::size_t element ) const { return offsets_[element + 1] - offsets_[element]; }
+
+  // Node numbers of the element in counter-clockwise order
+  std::size_t const* element_nodes( std::size_t element ) const { return &nodes_[offsets_[element]]; }
+
+  static double quad_quality( Point2 const& p1, Point2 const& p2, Point2 const& p3, Point2 const& p4 );
+
+private:
+
+  struct Candidate
+  {
+    bool operator<( Candidate const& c ) const
+    {
+      if ( quality != c.quality )
+      {
+        return quality > c.quality;
+      }
+
+      return faces[0] < c.faces[0] || ( faces[0] == c.faces[0] && faces[1] < c.faces[1] );
+    }
+
+    double      quality;
+    std::size_t faces[2];
+    std::size_t nodes[4];
+  };
+
+  typedef boost::unordered_map<Node const*, std::size_t>                         Node_numbers;
+  typedef boost::unordered_map<Face const*, std::size_t>                         Face_numbers;
+  typedef boost::unordered_map<std::pair<std::size_t, std::size_t>, std::size_t> Midpoints;
+
+  void add_element( std::size_t const* nodes, std::size_t size )
+  {
+    nodes_.insert( nodes_.end(), nodes, nodes + size );
+    offsets_.push_back( nodes_.size() );
+  }
+
+  std::size_t midpoint( Midpoints& midpoints, std::size_t n1, std::size_t n2 );
+
+  std::vector<Point2>      positions_;
+  std::vector<std::size_t> offsets_;
+  std::vector<std::size_t> nodes_;
+  std::size_t              num_edges_;
+};
+
+template <typename Triangulation>
+void Quad_dominant_mesh<Triangulation>::pair_triangles( Tria const& tria, double min_quality )
+{
+  clear();
+
+  Node_numbers node_numbers;
+  node_numbers.reserve( tria.number_of_nodes() );
+  positions_.reserve( tria.number_of_nodes() );
+
+  for ( Node_const_iterator iter = tria.nodes_begin(); iter != tria.nodes_end(); ++iter )
+  {
+    node_numbers[&*iter] = positions_.size();
+    positions_.push_back( iter->position() );
+  }
+
+  Face_numbers face_numbers;
+  face_numbers.reserve( tria.number_of_faces() );
+  std::size_t num_faces = 0;
+  std::vector<std::size_t> triangles;
+  triangles.reserve( 3 * tria.number_of_faces() );
+
+  for ( Face_const_iterator iter = tria.faces_begin(); iter != tria.faces_end(); ++iter )
+  {
+    face_numbers[&*iter] = num_faces++;
+    Node_handle n1, n2, n3;
+    iter->nodes( n1, n2, n3 );
+    triangles.push_back( node_numbers[&*n1] );
+    triangles.push_back( node_numbers[&*n2] );
+    triangles.push_back( node_numbers[&*n3] );
+  }
+
+  // The faces left of he1 and he2 are (a, b, c) and (b, a, d), so the
+  // quadrilateral is (a, d, b, c).
+  std::vector<Candidate> candidates;
+  candidates.reserve( tria.number_of_edges() );
+
+  for ( Edge_const_iterator iter = tria.edges_begin(); iter != tria.edges_end(); ++iter )
+  {
+    if ( iter->is_boundary() || iter->is_constrained() )
+    {
+      continue;
+    }
+
+    Halfedge_handle he1 = iter->he1();
+    Halfedge_handle he2 = iter->he2();
+    Candidate c;
+    c.faces[0] = face_numbers[&*he1->face()];
+    c.faces[1] = face_numbers[&*he2->face()];
+    c.nodes[0] = node_numbers[&*he1->origin()];
+    c.nodes[1] = node_numbers[&*he2->prev()->origin()];
+    c.nodes[2] = node_numbers[&*he2->origin()];
+    c.nodes[3] = node_numbers[&*he1->prev()->origin()];
+    c.quality = quad_quality( positions_[c.nodes[0]], positions_[c.nodes[1]], positions_[c.nodes[2]], positions_[c.nodes[3]] );
+
+    if ( c.quality > 0.0 && c.quality >= min_quality )
+    {
+      candidates.push_back( c );
+    }
+  }
+
+  std::sort( candidates.begin(), candidates.end() );
+
+  // For each face the candidate it was merged by, or none
+  std::size_t const none = candidates.size();
+  std::vector<std::size_t> merged( triangles.size() / 3, none );
+  std::size_t num_quads = 0;
+
+  for ( std::size_t i = 0; i < candidates.size(); ++i )
+  {
+    Candidate const& c = candidates[i];
+
+    if ( merged[c.faces[0]] == none && merged[c.faces[1]] == none )
+    {
+      merged[c.faces[0]] = i;
+      merged[c.faces[1]] = i;
+      ++num_quads;
+    }
+  }
+
+  nodes_.reserve( triangles.size() + num_quads );
+  offsets_.reserve( merged.size() - num_quads + 1 );
+
+  for ( std::size_t face = 0; face < merged.size(); ++face )
+  {
+    if ( merged[face] == none )
+    {
+      add_element( &triangles[3 * face], 3 );
+    }
+    else if ( candidates[merged[face]].faces[0] == face )
+    {
+      add_element( candidates[merged[face]].nodes, 4 );
+    }
+  }
+
+  num_edges_ = tria.number_of_edges() - num_quads;
+}
+
+// Each edge is halved and each element gets a node at its centroid joined to
+// the midpoints of its edges.
+template <typename Triangulation>
+void Quad_dominant_mesh<Triangulation>::split_into_quads()
+{
+  std::vector<std::size_t> offsets, nodes;
+  offsets.swap( offsets_ );
+  nodes.swap( nodes_ );
+  offsets_.reserve( nodes.size() + 1 );
+  offsets_.push_back( 0 );
+  nodes_.reserve( 4 * nodes.size() );
+  positions_.reserve( positions_.size() + num_edges_ + offsets.size() - 1 );
+
+  Midpoints midpoints;
+  midpoints.reserve( num_edges_ );
+  std::vector<std::size_t> edge_nodes;
+
+  for ( std::size_t element = 0; element + 1 < offsets.size(); ++element )
+  {
+    std::size_t const* corners = &nodes[offsets[element]];
+    std::size_t size = offsets[element + 1] - offsets[element];
+    Point2 centroid( Point2::Zero() );
+    edge_nodes.clear();
+
+    for ( std::size_t i = 0; i < size; ++i )
+    {
+      centroid += positions_[corners[i]];
+      edge_nodes.push_back( midpoint( midpoints, corners[i], corners[( i + 1 ) % size] ) );
+    }
+
+    std::size_t center = positions_.size();
+    positions_.push_back( centroid / static_cast<double>( size ) );
+
+    for ( std::size_t i = 0; i < size; ++i )
+    {
+      std::size_t quad[4] = { corners[i], edge_nodes[i], center, edge_nodes[( i + size - 1 ) % size] };
+      add_element( quad, 4 );
+    }
+  }
+
+  num_edges_ = 2 * num_edges_ + nodes.size();
+}
+
+template <typename Triangulation>
+std::size_t Quad_dominant_mesh<Triangulation>::midpoint( Midpoints& midpoints, std::size_t n1, std::size_t n2 )
+{
+  std::pair<typename Midpoints::iterator, bool> result = midpoints.insert(
+    std::make_pair( std::make_pair( std::min( n1, n2 ), std::max( n1, n2 ) ), positions_.size() ) );
+
+  if ( result.second )
+  {
+    positions_.push_back( 0.5 * ( positions_[n1] + positions_[n2] ) );
+  }
+
+  return result.first->second;
+}
+
+// Zero or less for non-convex quadrilaterals, one for rectangles
+template <typename Triangulation>
+double Quad_dominant_mesh<Triangulation>::quad_quality( Point2 const& p1, Point2 const& p2, Point2 const& p3, Point2 const& p4 )
+{
+  Point2 const* p[4] = { &p1, &p2, &p3, &p4 };
+  double max_deviation = 0.0;
+
+  for ( int i = 0; i < 4; ++i )
+  {
+    Point2 v1 = *p[( i + 1 ) % 4] - *p[i];
+    Point2 v2 = *p[( i + 3 ) % 4] - *p[i];
+    double cross = v1.x() * v2.y() - v1.y() * v2.x();
+
+    if ( cross <= 0.0 )
+    {
+      return 0.0;
+    }
+
+    double angle = std::atan2( cross, v1.dot( v2 ) );
+    max_deviation = std::max( max_deviation, std::abs( angle - 0.5 * M_PI ) );
+  }
+
+  return 1.0 - max_deviation / ( 0.5 * M_PI );
+}
+
+} // namespace umeshu
+
+#endif // UMESHU_QUAD_DOMINANT_MESH_H
@@ -23,11 +23,20 @@
 #define UMESHU_RELAXER_H
 
 #include "Point2.h"
+#include "Thread_pool.h"
 #include "Utils.h"
 
 #include <boost/assert.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered/unordered_set.hpp>
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <deque>
+#include <set>
+#include <vector>
 
 namespace umeshu {
 
@@ -38,67 +47,198 @@ public:
     typedef          Triangulation               Tria;
     typedef typename Tria::Kernel                Kernel;
 
+    typedef typename Tria::Node                  Node;
+    typedef typename Tria::Edge                  Edge;
+
     typedef typename Tria::Node_handle           Node_handle;
     typedef typename Tria::Halfedge_handle       Halfedge_handle;
     typedef typename Tria::Edge_handle           Edge_handle;
     typedef typename Tria::Face_handle           Face_handle;
 
+    Relaxer () : num_threads_(1) {
+        init_ideal_degree_bounds();
+    }
+
+    // The flips are done in rounds: the queued edges are tested
+    // concurrently, then the flips whose quadrilaterals share no node with
+    // each other are chosen and done concurrently. The flips left out are
+    // tested again in the next round. The worker threads are started once
+    // per relax() call, and the few edges left at the end of each threshold
+    // are flipped sequentially. The rounds do not depend on the number of
+    // threads, so neither does the relaxed mesh.
+    void set_num_threads (unsigned num_threads) {
+        num_threads_ = std::max(num_threads, 1u);
+    }
+
+    unsigned num_threads () const { return num_threads_; }
+
+    // Flips the edges whose relaxation index exceeds the threshold, for the
+    // thresholds 4, 3 and 2. Each round starts with all edges queued; after
+    // a flip, the edges whose index may have grown are queued again: those
+    // around the two nodes which gained an edge and those opposite to the
+    // two nodes which lost one. The ideal degrees depend only on the
+    // boundary, so the virtual degrees are computed once and then updated
+    // by the flips. They are kept in an array indexed by the node ids, which
+    // are renumbered here and restored at the end, so the triangulation
+    // needs items with ids (e.g. Delaunay_triangulation_items_with_id).
     void relax(Tria &tria) {
+        std::vector<std::size_t> ids;
+        ids.reserve(tria.number_of_nodes());
+        virtual_degrees_.resize(tria.number_of_nodes());
+        std::size_t id = 0;
+        typename Tria::Node_iterator node_iter = tria.nodes_begin();
+        for (; node_iter != tria.nodes_end(); ++node_iter, ++id) {
+            ids.push_back(node_iter->id());
+            node_iter->set_id(id);
+            virtual_degrees_[id] = static_cast<int>(node_iter->degree()) + (6 - ideal_degree(node_iter));
+        }
+
+        pool_.reset(new Thread_pool(num_threads_));
+
         for (int relax = 4; relax >=2; --relax)
         {
-            bool flipped = true;
-            while (flipped) {
-                flipped = false;
-                typename Tria::Edge_iterator edge_iter = tria.edges_begin();
-                for (; edge_iter != tria.edges_end(); ++edge_iter) {
-                    Edge_handle edge = edge_iter;
-                    if (edge->is_boundary()) {
-                        continue;
-                    }
-
-                    int index = edge_relaxation_index(edge);
-                    if (index > relax) {
-                        if (edge->is_diagonal_of_convex_quadrilateral()) {
-                            edge->flip();
-                            flipped = true;
-                        }
-                    }
+            typename Tria::Edge_iterator edge_iter = tria.edges_begin();
+            for (; edge_iter != tria.edges_end(); ++edge_iter) {
+                queue_edge(edge_iter);
+            }
+
+            relax_in_rounds(relax);
+
+            while (!queue_.empty()) {
+                Edge_handle edge = queue_.front();
+                queue_.pop_front();
+                queued_.erase(&(*edge));
+                if (is_flippable(edge, relax)) {
+                    flip(edge);
                 }
             }
         }
+        pool_.reset();
+        virtual_degrees_.clear();
 
-        // gboolean swapped = TRUE;
-        // while ( swapped )
-        // {
-        // swapped = FALSE;
-        // GList * edges_iter = mesh->edges;
-        // while( edges_iter != NULL )
-        // {
-        // Edge *edge = EDGE( edges_iter->data );
-        // edges_iter = g_list_next( edges_iter );
-
-        // if ( edge_is_at_boundary( edge ) )
-        // continue;
-
-        // Node *n1 = edge->he[0].origin;
-        // if ( node_is_at_boundary( n1 ) )
-        // continue;
-        // Node *n2 = edge->he[1].origin;
-        // if ( node_is_at_boundary( n2 ) )
-        // continue;
-
-        // if ( node_degree( n1 ) + node_degree( n2 ) == 10 )
-        // {
-        // mesh_collapse_edge( mesh, edge );
-        // edges_iter = mesh->edges;
-        // }
-        // }
-        // }
+        node_iter = tria.nodes_begin();
+        for (id = 0; node_iter != tria.nodes_end(); ++node_iter, ++id) {
+            node_iter->set_id(ids[id]);
+        }
+    }
+
+    // Collapses the interior edges joining two interior nodes whose degrees
+    // add up to ten into their midpoints, shortest edges first. The merged
+    // node has degree six and its neighbours lose degree, so after each
+    // collapse only the edges around the merged node and the opposite nodes
+    // of the collapsed edge are queued again. Returns the number of
+    // collapses.
+    std::size_t coarsen(Tria &tria) {
+        Candidates candidates;
+        typename Tria::Edge_iterator edge_iter = tria.edges_begin();
+        for (; edge_iter != tria.edges_end(); ++edge_iter) {
+            enqueue_candidate(candidates, edge_iter);
+        }
+
+        std::size_t num_collapses = 0;
+        while (!candidates.empty()) {
+            Edge_handle edge = candidates.begin()->edge();
+            candidates.erase(candidates.begin());
+
+            Node_handle n1 = edge->he1()->origin();
+            Node_handle n2 = edge->he2()->origin();
+            Point2 p = 0.5 * (n1->position() + n2->position());
+            if (!tria.can_collapse_edge(edge, p)) {
+                continue;
+            }
+
+            Node_handle n3 = edge->he1()->prev()->origin();
+            Node_handle n4 = edge->he2()->prev()->origin();
+            dequeue_candidates(candidates, n1);
+            dequeue_candidates(candidates, n2);
+            dequeue_candidates(candidates, n3);
+            dequeue_candidates(candidates, n4);
+
+            Node_handle n = tria.collapse_edge(edge, p);
+            enqueue_candidates(candidates, n);
+            enqueue_candidates(candidates, n3);
+            enqueue_candidates(candidates, n4);
+            ++num_collapses;
+        }
+        return num_collapses;
     }
 
     struct relaxer_error : virtual umeshu_error { };
 
 private:
+    class Candidate {
+    public:
+        explicit Candidate(Edge_handle e) : edge_(e), length_(e->length()) {}
+
+        Edge_handle edge() const { return edge_; }
+
+        bool operator< (Candidate const& c) const {
+            if (length_ != c.length_) {
+                return length_ < c.length_;
+            }
+            return &(*edge_) < &(*c.edge_);
+        }
+
+    private:
+        Edge_handle edge_;
+        double      length_;
+    };
+
+    typedef std::set<Candidate> Candidates;
+
+    static bool is_candidate(Edge_handle e) {
+        Node_handle n1 = e->he1()->origin();
+        Node_handle n2 = e->he2()->origin();
+        return !e->is_boundary() && !n1->is_boundary() && !n2->is_boundary() && n1->degree() + n2->degree() == 10;
+    }
+
+    static void enqueue_candidate(Candidates& candidates, Edge_handle e) {
+        if (is_candidate(e)) {
+            candidates.insert(Candidate(e));
+        }
+    }
+
+    static void enqueue_candidates(Candidates& candidates, Node_handle n) {
+        Halfedge_handle he = n->halfedge();
+        do {
+            enqueue_candidate(candidates, he->edge());
+            he = he->pair()->next();
+        } while (he != n->halfedge());
+    }
+
+    // The nodes have not moved since their edges were queued, so the
+    // lengths are the same.
+    static void dequeue_candidates(Candidates& candidates, Node_handle n) {
+        Halfedge_handle he = n->halfedge();
+        do {
+            candidates.erase(Candidate(he->edge()));
+            he = he->pair()->next();
+        } while (he != n->halfedge());
+    }
+
+    // The ideal degree of a boundary node grows with its interior angle by
+    // one at each of the angles 84.85, 146.97, 207.85, 268.33 and 328.63
+    // degrees. The angles are compared by their pseudo-angles, so the
+    // thresholds are converted once and no trigonometric function is
+    // evaluated per node.
+    void init_ideal_degree_bounds() {
+        static double const bounds[] = { 84.85, 146.97, 207.85, 268.33, 328.63 };
+        for (int i = 0; i < 5; ++i) {
+            double angle = utils::degrees_to_radians(bounds[i]);
+            ideal_degree_bounds_[i] = pseudo_angle(std::cos(angle), std::sin(angle));
+        }
+    }
+
+    // A number in [0, 4) which increases with the angle in [0, 2*pi) of the
+    // vector (x, y), like the angle with the unit circle replaced by the
+    // diamond |x| + |y| = 1.
+    static double pseudo_angle(double x, double y) {
+        if (y >= 0.0) {
+            return x >= 0.0 ? y / (x + y) : 1.0 - x / (y - x);
+        }
+        return x < 0.0 ? 2.0 - y / (-x - y) : 3.0 + x / (x - y);
+    }
+
     int ideal_degree(Node_handle n) const {
         // ideal degree for an interior point
         int D = 6;
@@ -112,42 +252,132 @@ private:
             Point2 const& p2 = he2->origin()->position();
             Point2 const& p3 = he2->pair()->origin()->position();
 
-            double v1[2], v2[2];
-            v1[0] = p1.x() - p2.x();
-            v1[1] = p1.y() - p2.y();
-            v2[0] = p3.x() - p2.x();
-            v2[1] = p3.y() - p2.y();
+            Point2 v1 = p1 - p2;
+            Point2 v2 = p3 - p2;
+            double angle = pseudo_angle(v1.dot(v2), v1.x()*v2.y() - v2.x()*v1.y());
+
+            D = 2;
+            while (D < 7 && angle > ideal_degree_bounds_[D - 2]) {
+                ++D;
+            }
+        }
+        return D;
+    }
+
+    // The ends of an edge and the opposite nodes of its faces
+    struct Quad {
+        explicit Quad(Edge_handle e)
+            : edge(e)
+            , n1(e->he1()->origin())
+            , n2(e->he2()->origin())
+            , n3(e->he1()->prev()->origin())
+            , n4(e->he2()->prev()->origin())
+        {}
+
+        Edge_handle edge;
+        Node_handle n1, n2, n3, n4;
+    };
+
+    // A round is worth the synchronization only with enough queued edges,
+    // the rest are left to the sequential worklist.
+    void relax_in_rounds(int relax) {
+        while (queue_.size() >= 256) {
+            batch_.assign(queue_.begin(), queue_.end());
+            queue_.clear();
+            queued_.clear();
+            flippable_.assign(batch_.size(), 0);
 
-            double angle = ::atan2( v1[0]*v2[1] - v2[0]*v1[1], v1[0]*v2[0] + v1[1]*v2[1] );
-            if (angle < 0.0) {
-                angle = 2.0*M_PI + angle;
+            pool_->run(boost::bind(&Relaxer::test_edges, this, boost::placeholders::_1, relax));
+
+            quads_.clear();
+            claimed_nodes_.clear();
+            for (std::size_t i = 0; i < batch_.size(); ++i) {
+                if (!flippable_[i]) {
+                    continue;
+                }
+                Quad q(batch_[i]);
+                if (claimed_nodes_.count(&(*q.n1)) || claimed_nodes_.count(&(*q.n2)) ||
+                    claimed_nodes_.count(&(*q.n3)) || claimed_nodes_.count(&(*q.n4))) {
+                    queue_edge(q.edge);
+                    continue;
+                }
+                claimed_nodes_.insert(&(*q.n1));
+                claimed_nodes_.insert(&(*q.n2));
+                claimed_nodes_.insert(&(*q.n3));
+                claimed_nodes_.insert(&(*q.n4));
+                quads_.push_back(q);
             }
 
-            if (angle <= utils::degrees_to_radians(84.85)) {
-                D = 2;
-            } else if (angle >  utils::degrees_to_radians( 84.85) &&
-                       angle <= utils::degrees_to_radians(146.97)) {
-                D = 3;
-            } else if (angle >  utils::degrees_to_radians(146.97) &&
-                       angle <= utils::degrees_to_radians(207.85)) {
-                D = 4;
-            } else if (angle >  utils::degrees_to_radians(207.85) &&
-                       angle <= utils::degrees_to_radians(268.33)) {
-                D = 5;
-            } else if (angle >  utils::degrees_to_radians(268.33) &&
-                       angle <= utils::degrees_to_radians(328.63)) {
-                D = 6;
-            } else {
-                BOOST_ASSERT(angle > utils::degrees_to_radians(328.63) &&
-                             angle < utils::degrees_to_radians(360.0));
-                D = 7;
+            // The quadrilaterals are disjoint, so the flips touch disjoint
+            // parts of the mesh.
+            pool_->run(boost::bind(&Relaxer::flip_quads, this, boost::placeholders::_1));
+
+            for (typename std::vector<Quad>::const_iterator iter = quads_.begin(); iter != quads_.end(); ++iter) {
+                flipped(*iter);
             }
         }
-        return D;
+    }
+
+    void test_edges(unsigned thread, int relax) {
+        for (std::size_t i = thread; i < batch_.size(); i += pool_->size()) {
+            flippable_[i] = is_flippable(batch_[i], relax);
+        }
+    }
+
+    void flip_quads(unsigned thread) {
+        for (std::size_t i = thread; i < quads_.size(); i += pool_->size()) {
+            quads_[i].edge->flip();
+        }
+    }
+
+    bool is_flippable(Edge_handle e, int relax) const {
+        return !e->is_boundary() && edge_relaxation_index(e) > relax && e->is_diagonal_of_convex_quadrilateral();
+    }
+
+    void flip(Edge_handle e) {
+        Quad q(e);
+        e->flip();
+        flipped(q);
+    }
+
+    void flipped(Quad const& q) {
+        --virtual_degrees_[q.n1->id()];
+        --virtual_degrees_[q.n2->id()];
+        ++virtual_degrees_[q.n3->id()];
+        ++virtual_degrees_[q.n4->id()];
+
+        queue_edges_around(q.n3);
+        queue_edges_around(q.n4);
+        queue_opposite_edges(q.n1);
+        queue_opposite_edges(q.n2);
     }
 
     int virtual_degree(Node_handle n) const {
-        return n->degree() + (6 - ideal_degree(n));
+        return virtual_degrees_[n->id()];
+    }
+
+    void queue_edge(Edge_handle e) {
+        if (queued_.insert(&(*e)).second) {
+            queue_.push_back(e);
+        }
+    }
+
+    void queue_edges_around(Node_handle n) {
+        Halfedge_handle he = n->halfedge();
+        do {
+            queue_edge(he->edge());
+            he = he->pair()->next();
+        } while (he != n->halfedge());
+    }
+
+    void queue_opposite_edges(Node_handle n) {
+        Halfedge_handle he = n->halfedge();
+        do {
+            if (!he->is_boundary()) {
+                queue_edge(he->next()->edge());
+            }
+            he = he->pair()->next();
+        } while (he != n->halfedge());
     }
 
     int edge_relaxation_index(Edge_handle e) const {
@@ -157,6 +387,17 @@ private:
         Node_handle n4 = e->he2()->prev()->origin();
         return virtual_degree(n1) + virtual_degree(n2) - virtual_degree(n3) - virtual_degree(n4);
     }
+
+    unsigned                               num_threads_;
+    double                                 ideal_degree_bounds_[5];
+    std::vector<int>                       virtual_degrees_;
+    std::deque<Edge_handle>                queue_;
+    boost::unordered_set<Edge const*>      queued_;
+    std::vector<Edge_handle>               batch_;
+    std::vector<unsigned char>             flippable_;
+    std::vector<Quad>                      quads_;
+    boost::unordered_set<Node const*>      claimed_nodes_;
+    boost::shared_ptr<Thread_pool>         pool_;
 };
 
 } // namespace umeshu
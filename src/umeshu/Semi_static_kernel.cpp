@@ -0,0 +1,63 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+#include "Semi_static_kernel.h"
+
+#include <limits>
+
+namespace umeshu
+{
+
+double Semi_static_kernel::xmin_ = 1.0;
+double Semi_static_kernel::xmax_ = -1.0;
+double Semi_static_kernel::ymin_ = 1.0;
+double Semi_static_kernel::ymax_ = -1.0;
+double Semi_static_kernel::orient_bound_ = 0.0;
+double Semi_static_kernel::incircle_bound_ = 0.0;
+
+// Shewchuk's bounds are errbound * permanent, with errbound (3 + 16 eps) eps
+// for orient2d and (10 + 96 eps) eps for incircle. With the differences
+// bounded by the extents w and h of the padded box, the permanent of
+// orient2d is at most 2 w h and that of incircle 6 w h (w^2 + h^2). The
+// bounds are enlarged slightly to cover the rounding in computing them and
+// in the permanents.
+void Semi_static_kernel::set_bounding_box( Bounding_box const& box )
+{
+  double const eps = 0.5 * std::numeric_limits<double>::epsilon();
+  double const margin = 1.0 + 64.0 * eps;
+
+  double const pad_x = 0.25 * ( box.max_corner()( 0 ) - box.min_corner()( 0 ) );
+  double const pad_y = 0.25 * ( box.max_corner()( 1 ) - box.min_corner()( 1 ) );
+
+  xmin_ = box.min_corner()( 0 ) - pad_x;
+  xmax_ = box.max_corner()( 0 ) + pad_x;
+  ymin_ = box.min_corner()( 1 ) - pad_y;
+  ymax_ = box.max_corner()( 1 ) + pad_y;
+
+  double const width = margin * ( xmax_ - xmin_ );
+  double const height = margin * ( ymax_ - ymin_ );
+
+  orient_bound_ = margin * ( 3.0 + 16.0 * eps ) * eps * 2.0 * width * height;
+  incircle_bound_ = margin * ( 10.0 + 96.0 * eps ) * eps * 6.0 * width * height * ( width * width + height * height );
+}
+
+} // namespace umeshu
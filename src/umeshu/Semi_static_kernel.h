@@ -0,0 +1,125 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+#ifndef UMESHU_SEMI_STATIC_KERNEL_H
+#define UMESHU_SEMI_STATIC_KERNEL_H
+
+#include "Bounding_box.h"
+#include "Exact_adaptive_kernel.h"
+
+namespace umeshu
+{
+
+// Kernel whose predicates first compare the approximate determinant with an
+// error bound computed once from a bounding box of the input, instead of
+// with Shewchuk's bound computed at each call from the magnitudes of the
+// terms. The box is padded by a quarter of its extent on each side, and the
+// static bound holds whenever all the points of a query lie in the padded
+// box. Only the test point is checked, because the other points are
+// expected to be nodes of the mesh, which lie in the box of the input.
+// Queries with a test point outside, e.g., a far circumcenter, and those
+// whose determinant is within the bound, are decided by the adaptive
+// predicates of Exact_adaptive_kernel. Until set_bounding_box() is called,
+// all queries are. The box is shared by all triangulations using this
+// kernel, so it has to be set before and must not change during their
+// construction, e.g., to the bounding box of the input polygon.
+struct Semi_static_kernel : public Exact_adaptive_kernel
+{
+  static void set_bounding_box( Bounding_box const& box );
+
+  static Oriented_side oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test );
+  static Oriented_side oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test );
+
+private:
+
+  static bool in_box( Point2 const& p );
+
+  static double xmin_, xmax_;
+  static double ymin_, ymax_;
+  static double orient_bound_;
+  static double incircle_bound_;
+};
+
+// The fast paths are inline so that the common case costs no call.
+inline bool Semi_static_kernel::in_box( Point2 const& p )
+{
+  return p( 0 ) >= xmin_ && p( 0 ) <= xmax_ && p( 1 ) >= ymin_ && p( 1 ) <= ymax_;
+}
+
+inline Oriented_side Semi_static_kernel::oriented_side( Point2 const& pa, Point2 const& pb, Point2 const& test )
+{
+  if ( in_box( test ) )
+  {
+    double acx = pa( 0 ) - test( 0 );
+    double bcx = pb( 0 ) - test( 0 );
+    double acy = pa( 1 ) - test( 1 );
+    double bcy = pb( 1 ) - test( 1 );
+    double det = acx * bcy - acy * bcx;
+
+    if ( det > orient_bound_ )
+    {
+      return ON_POSITIVE_SIDE;
+    }
+
+    if ( -det > orient_bound_ )
+    {
+      return ON_NEGATIVE_SIDE;
+    }
+  }
+
+  return Exact_adaptive_kernel::oriented_side( pa, pb, test );
+}
+
+inline Oriented_side Semi_static_kernel::oriented_circle( Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test )
+{
+  if ( in_box( test ) )
+  {
+    double adx = pa( 0 ) - test( 0 );
+    double bdx = pb( 0 ) - test( 0 );
+    double cdx = pc( 0 ) - test( 0 );
+    double ady = pa( 1 ) - test( 1 );
+    double bdy = pb( 1 ) - test( 1 );
+    double cdy = pc( 1 ) - test( 1 );
+    double alift = adx * adx + ady * ady;
+    double blift = bdx * bdx + bdy * bdy;
+    double clift = cdx * cdx + cdy * cdy;
+    double det = alift * ( bdx * cdy - cdx * bdy )
+               + blift * ( cdx * ady - adx * cdy )
+               + clift * ( adx * bdy - bdx * ady );
+
+    if ( det > incircle_bound_ )
+    {
+      return ON_POSITIVE_SIDE;
+    }
+
+    if ( -det > incircle_bound_ )
+    {
+      return ON_NEGATIVE_SIDE;
+    }
+  }
+
+  return Exact_adaptive_kernel::oriented_circle( pa, pb, pc, test );
+}
+
+} // namespace umeshu
+
+#endif // UMESHU_SEMI_STATIC_KERNEL_H
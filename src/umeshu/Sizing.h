@@ -0,0 +1,389 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+#ifndef UMESHU_SIZING_H
+#define UMESHU_SIZING_H
+
+#include "Bounding_box.h"
+#include "Point2.h"
+#include "Triangulation.h"
+
+#include <boost/assert.hpp>
+#include <boost/geometry/geometries/segment.hpp>
+#include <boost/geometry/index/rtree.hpp>
+#include <boost/unordered/unordered_map.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace umeshu
+{
+
+// Size function defined by sizes given at the nodes of a background
+// triangulation and interpolated linearly over its faces. Outside of the
+// background triangulation the size is interpolated along the boundary edge
+// where the point location stopped. Points the walk cannot reach are looked
+// up in an R-tree of the faces, built on first use, so the background
+// triangulation must not change once the size function has been evaluated.
+// The last located face is remembered, so a single instance must not be
+// shared by several threads.
+template <typename Triangulation>
+class Background_mesh_size
+{
+public:
+  typedef          Triangulation         Tria;
+  typedef typename Tria::Kernel          Kernel;
+
+  typedef typename Tria::Node            Node;
+
+  typedef typename Tria::Node_handle     Node_handle;
+  typedef typename Tria::Halfedge_handle Halfedge_handle;
+  typedef typename Tria::Edge_handle     Edge_handle;
+  typedef typename Tria::Face_handle     Face_handle;
+
+  explicit Background_mesh_size( Tria& mesh )
+    : mesh_( &mesh )
+    , hint_()
+  {}
+
+  void set_size( Node_handle n, double h )
+  {
+    sizes_[&*n] = h;
+  }
+
+  double size( Node_handle n ) const
+  {
+    typename Sizes::const_iterator iter = sizes_.find( &*n );
+    BOOST_ASSERT( iter != sizes_.end() );
+    return iter->second;
+  }
+
+  double operator()( Point2 const& p ) const
+  {
+    Point_location loc;
+    Node_handle node;
+    Edge_handle edge;
+    Face_handle face = mesh_->locate( p, loc, node, edge, hint_ );
+
+    if ( loc == OUTSIDE_MESH )
+    {
+      // The walk stops at the first boundary edge it meets, which in a
+      // non-convex background triangulation need not mean that p is outside.
+      face = find_face( p );
+
+      if ( face != Face_handle() )
+      {
+        loc = IN_FACE;
+      }
+    }
+
+    switch ( loc )
+    {
+    case IN_FACE:
+    {
+      hint_ = face;
+      return interpolate( face, p );
+    }
+
+    case ON_NODE:
+      return size( node );
+
+    default: // ON_EDGE, OUTSIDE_MESH
+    {
+      hint_ = edge->he1()->is_boundary() ? edge->he2()->face() : edge->he1()->face();
+      Node_handle n1 = edge->he1()->origin();
+      Node_handle n2 = edge->he2()->origin();
+      Point2 d = n2->position() - n1->position();
+      double t = d.dot( p - n1->position() ) / d.squaredNorm();
+      t = std::min( 1.0, std::max( 0.0, t ) );
+      return ( 1.0 - t ) * size( n1 ) + t * size( n2 );
+    }
+    }
+  }
+
+private:
+
+  typedef boost::unordered_map<Node const*, double> Sizes;
+  typedef std::pair<Bounding_box, Face_handle> Face_value;
+  typedef boost::geometry::index::rtree< Face_value, boost::geometry::index::quadratic<16> > Face_tree;
+
+  double interpolate( Face_handle face, Point2 const& p ) const
+  {
+    Node_handle n1, n2, n3;
+    face->nodes( n1, n2, n3 );
+    Point2 const& p1 = n1->position();
+    Point2 const& p2 = n2->position();
+    Point2 const& p3 = n3->position();
+    double area = Kernel::signed_area( p1, p2, p3 );
+    double l1 = Kernel::signed_area( p, p2, p3 ) / area;
+    double l2 = Kernel::signed_area( p1, p, p3 ) / area;
+    return l1 * size( n1 ) + l2 * size( n2 ) + ( 1.0 - l1 - l2 ) * size( n3 );
+  }
+
+  Face_handle find_face( Point2 const& p ) const
+  {
+    if ( faces_.empty() )
+    {
+      index_faces();
+    }
+
+    for ( typename Face_tree::const_query_iterator q = faces_.qbegin( boost::geometry::index::intersects( p ) ); q != faces_.qend(); ++q )
+    {
+      Point2 p1, p2, p3;
+      q->second->vertices( p1, p2, p3 );
+
+      if ( Kernel::oriented_side( p1, p2, p ) != ON_NEGATIVE_SIDE &&
+           Kernel::oriented_side( p2, p3, p ) != ON_NEGATIVE_SIDE &&
+           Kernel::oriented_side( p3, p1, p ) != ON_NEGATIVE_SIDE )
+      {
+        return q->second;
+      }
+    }
+
+    return Face_handle();
+  }
+
+  void index_faces() const
+  {
+    std::vector<Face_value> values;
+    values.reserve( mesh_->number_of_faces() );
+
+    for ( typename Tria::Face_iterator iter = mesh_->faces_begin(); iter != mesh_->faces_end(); ++iter )
+    {
+      Point2 p1, p2, p3;
+      iter->vertices( p1, p2, p3 );
+      Bounding_box box = boost::geometry::make_inverse<Bounding_box>();
+      boost::geometry::expand( box, p1 );
+      boost::geometry::expand( box, p2 );
+      boost::geometry::expand( box, p3 );
+      values.push_back( Face_value( box, iter ) );
+    }
+
+    Face_tree tree( values.begin(), values.end() );
+    faces_.swap( tree );
+  }
+
+  Tria* mesh_;
+  Sizes sizes_;
+  mutable Face_handle hint_;
+  mutable Face_tree faces_;
+};
+
+// Size function constant on each of a set of triangles and unbounded
+// elsewhere. Where the triangles overlap, the smallest size applies. The
+// triangles are kept by value, so the size function does not depend on the
+// mesh they may have been taken from and can be used while it is refined.
+template <typename Kernel>
+class Triangle_size
+{
+public:
+
+  void add_triangle( Point2 const& p1, Point2 const& p2, Point2 const& p3, double h )
+  {
+    Triangle t = { { p1, p2, p3 }, h };
+    Bounding_box box = boost::geometry::make_inverse<Bounding_box>();
+    boost::geometry::expand( box, p1 );
+    boost::geometry::expand( box, p2 );
+    boost::geometry::expand( box, p3 );
+    tree_.insert( Box_value( box, triangles_.size() ) );
+    triangles_.push_back( t );
+  }
+
+  std::size_t number_of_triangles() const
+  {
+    return triangles_.size();
+  }
+
+  double operator()( Point2 const& p ) const
+  {
+    double h = std::numeric_limits<double>::max();
+
+    for ( typename Box_tree::const_query_iterator q = tree_.qbegin( boost::geometry::index::intersects( p ) ); q != tree_.qend(); ++q )
+    {
+      Triangle const& t = triangles_[q->second];
+
+      if ( t.size < h &&
+           Kernel::oriented_side( t.vertices[0], t.vertices[1], p ) != ON_NEGATIVE_SIDE &&
+           Kernel::oriented_side( t.vertices[1], t.vertices[2], p ) != ON_NEGATIVE_SIDE &&
+           Kernel::oriented_side( t.vertices[2], t.vertices[0], p ) != ON_NEGATIVE_SIDE )
+      {
+        h = t.size;
+      }
+    }
+
+    return h;
+  }
+
+private:
+
+  struct Triangle
+  {
+    Point2 vertices[3];
+    double size;
+  };
+
+  typedef std::pair<Bounding_box, std::size_t> Box_value;
+  typedef boost::geometry::index::rtree< Box_value, boost::geometry::index::quadratic<16> > Box_tree;
+
+  std::vector<Triangle> triangles_;
+  Box_tree tree_;
+};
+
+// Local feature size of the input of a constrained Delaunay triangulation.
+// At a node it is the distance to the nearest node or boundary or
+// constrained edge not incident to it. The nearest nodes are found among the
+// neighbours in the triangulation, the nearest edges by a query to an R-tree,
+// since features facing each other across the exterior of the domain (e.g.,
+// the two sides of a crack) are not connected by the triangulation. The
+// nodal values are then limited so that they grow by at most the gradation
+// times the distance along the edges, and are interpolated over the faces as
+// in Background_mesh_size. The triangulation serves as the background mesh,
+// so it has to outlive the size function and must not be the one refined.
+template <typename Delaunay_triangulation>
+class Local_feature_size : public Background_mesh_size<Delaunay_triangulation>
+{
+public:
+  typedef Background_mesh_size<Delaunay_triangulation> Base;
+
+  typedef typename Base::Tria            Tria;
+  typedef typename Base::Kernel          Kernel;
+  typedef typename Base::Node            Node;
+  typedef typename Base::Node_handle     Node_handle;
+  typedef typename Base::Halfedge_handle Halfedge_handle;
+  typedef typename Base::Edge_handle     Edge_handle;
+  typedef typename Base::Face_handle     Face_handle;
+
+  Local_feature_size( Tria& cdt, double gradation )
+    : Base( cdt )
+  {
+    BOOST_ASSERT( gradation > 0.0 );
+
+    for ( typename Tria::Node_iterator iter = cdt.nodes_begin(); iter != cdt.nodes_end(); ++iter )
+    {
+      this->set_size( iter, std::numeric_limits<double>::max() );
+    }
+
+    Segments segments;
+
+    for ( typename Tria::Edge_iterator iter = cdt.edges_begin(); iter != cdt.edges_end(); ++iter )
+    {
+      Halfedge_handle he = iter->he1();
+      Point2 const& p1 = he->origin()->position();
+      Point2 const& p2 = he->pair()->origin()->position();
+      double d = Kernel::distance( p1, p2 );
+      limit_size( he->origin(), d );
+      limit_size( he->pair()->origin(), d );
+
+      if ( iter->is_boundary() || iter->is_constrained() )
+      {
+        segments.push_back( Segment_value( Segment( p1, p2 ), he ) );
+      }
+    }
+
+    Segment_tree tree( segments.begin(), segments.end() );
+
+    for ( typename Tria::Node_iterator iter = cdt.nodes_begin(); iter != cdt.nodes_end(); ++iter )
+    {
+      Point2 const& p = iter->position();
+
+      for ( typename Segment_tree::const_query_iterator q = tree.qbegin( boost::geometry::index::nearest( p, segments.size() ) ); q != tree.qend(); ++q )
+      {
+        Halfedge_handle he = q->second;
+
+        if ( he->origin() != iter && he->pair()->origin() != iter )
+        {
+          limit_size( iter, boost::geometry::distance( p, q->first ) );
+          break;
+        }
+      }
+    }
+
+    grade( cdt, gradation );
+  }
+
+private:
+
+  typedef boost::geometry::model::segment<Point2> Segment;
+  typedef std::pair<Segment, Halfedge_handle> Segment_value;
+  typedef std::vector<Segment_value> Segments;
+  typedef boost::geometry::index::rtree< Segment_value, boost::geometry::index::quadratic<16> > Segment_tree;
+
+  typedef std::pair<double, Node const*> Queued_node;
+  typedef std::priority_queue< Queued_node, std::vector<Queued_node>, std::greater<Queued_node> > Node_queue;
+
+  void limit_size( Node_handle n, double h )
+  {
+    if ( h < this->size( n ) )
+    {
+      this->set_size( n, h );
+    }
+  }
+
+  // Dijkstra's algorithm with the edge lengths scaled by the gradation
+  void grade( Tria& cdt, double gradation )
+  {
+    Node_queue queue;
+
+    for ( typename Tria::Node_iterator iter = cdt.nodes_begin(); iter != cdt.nodes_end(); ++iter )
+    {
+      queue.push( Queued_node( this->size( iter ), &*iter ) );
+    }
+
+    while ( !queue.empty() )
+    {
+      Queued_node top = queue.top();
+      queue.pop();
+
+      Halfedge_handle he_start = top.second->halfedge();
+
+      if ( top.first > this->size( he_start->origin() ) )
+      {
+        continue;
+      }
+
+      Halfedge_handle he = he_start;
+
+      do
+      {
+        Node_handle n = he->pair()->origin();
+        double h = top.first + gradation * Kernel::distance( n->position(), he->origin()->position() );
+
+        if ( h < this->size( n ) )
+        {
+          this->set_size( n, h );
+          queue.push( Queued_node( h, &*n ) );
+        }
+
+        he = he->pair()->next();
+      }
+      while ( he != he_start );
+    }
+  }
+};
+
+} // namespace umeshu
+
+#endif // UMESHU_SIZING_H
@@ -0,0 +1,374 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+#ifndef UMESHU_SMOOTHER_H
+#define UMESHU_SMOOTHER_H
+
+#include "Point2.h"
+#include "Thread_pool.h"
+
+#include <boost/bind/bind.hpp>
+#include <boost/unordered/unordered_map.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace umeshu {
+
+// Moves the interior nodes of a constrained Delaunay triangulation to
+// improve the shape of its faces. The nodes on the boundary and on
+// constrained edges stay fixed. Each sweep computes the new positions of
+// all movable nodes from the old ones (a Jacobi iteration), so the nodes
+// can be processed concurrently; then the moves that invert a face are
+// undone and the Delaunay property is restored by flips around the moved
+// nodes. The flips undo those of a preceding relaxation, so the mesh is to
+// be smoothed first.
+//
+// The sweeps work on flat arrays: the positions of all nodes, and for each
+// movable node the indices of its neighbours in counter-clockwise order.
+// After the flips only the rings of the nodes of the flipped edges are
+// gathered again from the triangulation.
+template <typename Triangulation>
+class Smoother {
+public:
+    typedef          Triangulation               Tria;
+    typedef typename Tria::Kernel                Kernel;
+
+    typedef typename Tria::Node                  Node;
+
+    typedef typename Tria::Node_handle           Node_handle;
+    typedef typename Tria::Halfedge_handle       Halfedge_handle;
+    typedef typename Tria::Edge_handle           Edge_handle;
+
+    enum Method {
+        // the average of the neighbours
+        LAPLACIAN,
+        // the average of the circumcenters of the surrounding faces weighted
+        // by their areas (Optimal Delaunay Triangulation)
+        ODT,
+        // the centroid of the Voronoi cell (Lloyd's iteration towards a
+        // Centroidal Voronoi Tessellation)
+        CVT
+    };
+
+    Smoother () : method_(ODT), num_threads_(1), num_rollbacks_(0) {}
+
+    void set_method (Method method) { method_ = method; }
+
+    Method method () const { return method_; }
+
+    void set_num_threads (unsigned num_threads) {
+        num_threads_ = std::max(num_threads, 1u);
+    }
+
+    unsigned num_threads () const { return num_threads_; }
+
+    // The worker threads are started once for all the sweeps.
+    void smooth (Tria &tria, int num_sweeps) {
+        num_rollbacks_ = 0;
+        index_nodes(tria);
+        gather_rings();
+        Thread_pool pool(num_threads_);
+        for (int sweep = 0; sweep < num_sweeps; ++sweep) {
+            pool.run(boost::bind(&Smoother::compute_positions, this, boost::placeholders::_1));
+            move_nodes();
+            restore_delaunay(tria);
+        }
+        nodes_.clear();
+        indices_.clear();
+        positions_.clear();
+        movable_.clear();
+        slots_.clear();
+        ring_starts_.clear();
+        rings_.clear();
+        new_positions_.clear();
+    }
+
+    // The number of node moves undone during the last call to smooth()
+    std::size_t number_of_rollbacks () const { return num_rollbacks_; }
+
+private:
+    static std::size_t const NOT_MOVABLE = static_cast<std::size_t>(-1);
+
+    static bool is_movable (Node_handle n) {
+        if (n->is_boundary()) {
+            return false;
+        }
+        Halfedge_handle he = n->halfedge();
+        do {
+            if (he->edge()->is_constrained()) {
+                return false;
+            }
+            he = he->pair()->next();
+        } while (he != n->halfedge());
+        return true;
+    }
+
+    // Numbers the nodes through a map rather than their ids, which belong
+    // to the caller.
+    void index_nodes (Tria &tria) {
+        nodes_.clear();
+        indices_.clear();
+        positions_.clear();
+        movable_.clear();
+        slots_.clear();
+        typename Tria::Node_iterator iter = tria.nodes_begin();
+        for (; iter != tria.nodes_end(); ++iter) {
+            indices_[&(*iter)] = nodes_.size();
+            if (is_movable(iter)) {
+                slots_.push_back(movable_.size());
+                movable_.push_back(nodes_.size());
+            } else {
+                slots_.push_back(NOT_MOVABLE);
+            }
+            nodes_.push_back(iter);
+            positions_.push_back(iter->position());
+        }
+        new_positions_.assign(movable_.size(), Point2::Zero());
+        moved_.assign(nodes_.size(), 0);
+    }
+
+    // A movable node is interior, so its neighbours close a ring and every
+    // two consecutive ones form a face with it. The ring starts with the
+    // other end of the node's halfedge.
+    void gather_rings () {
+        ring_starts_.clear();
+        rings_.clear();
+        for (std::size_t k = 0; k < movable_.size(); ++k) {
+            ring_starts_.push_back(rings_.size());
+            gather_ring(k, rings_);
+        }
+        ring_starts_.push_back(rings_.size());
+    }
+
+    void gather_ring (std::size_t k, std::vector<std::size_t> &rings) const {
+        Node_handle n = nodes_[movable_[k]];
+        Halfedge_handle he = n->halfedge();
+        do {
+            rings.push_back(indices_.find(&(*he->pair()->origin()))->second);
+            he = he->prev()->pair();
+        } while (he != n->halfedge());
+    }
+
+    // A flip changes the rings of the four nodes of its quadrilateral and
+    // no other; the rest are copied.
+    void update_rings (std::vector<Edge_handle> const& flipped) {
+        changed_.assign(movable_.size(), 0);
+        for (std::size_t f = 0; f < flipped.size(); ++f) {
+            Halfedge_handle he = flipped[f]->he1();
+            Node_handle quad[] = { he->origin(), he->pair()->origin(), he->prev()->origin(), he->pair()->prev()->origin() };
+            for (int i = 0; i < 4; ++i) {
+                std::size_t k = slots_[indices_.find(&(*quad[i]))->second];
+                if (k != NOT_MOVABLE) {
+                    changed_[k] = 1;
+                }
+            }
+        }
+
+        std::vector<std::size_t> starts, rings;
+        starts.reserve(ring_starts_.size());
+        rings.reserve(rings_.size() + 2 * flipped.size());
+        for (std::size_t k = 0; k < movable_.size(); ++k) {
+            starts.push_back(rings.size());
+            if (changed_[k]) {
+                gather_ring(k, rings);
+            } else {
+                rings.insert(rings.end(), rings_.begin() + ring_starts_[k], rings_.begin() + ring_starts_[k + 1]);
+            }
+        }
+        starts.push_back(rings.size());
+        ring_starts_.swap(starts);
+        rings_.swap(rings);
+    }
+
+    void compute_positions (unsigned thread) {
+        for (std::size_t k = thread; k < movable_.size(); k += num_threads_) {
+            // The circumcenters of an inverted face say nothing about where
+            // the node should go, but the average of the neighbours usually
+            // untangles it.
+            if (method_ == LAPLACIAN || has_inverted_face(k)) {
+                new_positions_[k] = Kernel::snap(laplacian_position(k));
+                continue;
+            }
+            switch (method_) {
+            case ODT:
+                new_positions_[k] = Kernel::snap(odt_position(k));
+                break;
+            default:
+                new_positions_[k] = Kernel::snap(cvt_position(k));
+                break;
+            }
+        }
+    }
+
+    Point2 laplacian_position (std::size_t k) const {
+        Point2 sum(Point2::Zero());
+        for (std::size_t j = ring_starts_[k]; j < ring_starts_[k + 1]; ++j) {
+            sum += positions_[rings_[j]];
+        }
+        return sum / static_cast<double>(ring_starts_[k + 1] - ring_starts_[k]);
+    }
+
+    Point2 odt_position (std::size_t k) const {
+        Point2 const& p = positions_[movable_[k]];
+        Point2 sum(Point2::Zero());
+        double area = 0.0;
+        std::size_t first = ring_starts_[k], last = ring_starts_[k + 1] - 1;
+        for (std::size_t j = first; j <= last; ++j) {
+            Point2 const& q1 = positions_[rings_[j]];
+            Point2 const& q2 = positions_[rings_[j < last ? j + 1 : first]];
+            double a = Kernel::signed_area(p, q1, q2);
+            sum += a * Kernel::circumcenter(p, q1, q2);
+            area += a;
+        }
+        return area > 0.0 ? Point2(sum / area) : p;
+    }
+
+    // The circumcenters of the surrounding faces, taken counter-clockwise,
+    // are the vertices of the Voronoi cell, whose centroid is computed by
+    // the shoelace formula relative to the node.
+    Point2 cvt_position (std::size_t k) const {
+        Point2 const& p = positions_[movable_[k]];
+        Point2 sum(Point2::Zero());
+        double area = 0.0;
+        std::size_t first = ring_starts_[k], last = ring_starts_[k + 1] - 1;
+        Point2 c1 = Kernel::circumcenter(p, positions_[rings_[last]], positions_[rings_[first]]) - p;
+        for (std::size_t j = first; j <= last; ++j) {
+            Point2 const& q1 = positions_[rings_[j]];
+            Point2 const& q2 = positions_[rings_[j < last ? j + 1 : first]];
+            Point2 c2 = Kernel::circumcenter(p, q1, q2) - p;
+            double a = c1.x() * c2.y() - c2.x() * c1.y();
+            sum += a * (c1 + c2);
+            area += a;
+            c1 = c2;
+        }
+        return area > 0.0 ? Point2(p + sum / (3.0 * area)) : p;
+    }
+
+    // Moves all nodes, then puts back the moved nodes of the faces which
+    // became inverted until no such face is left. Faces inverted before the
+    // sweep may stay so after all their nodes are back.
+    void move_nodes () {
+        old_positions_.resize(movable_.size());
+        for (std::size_t k = 0; k < movable_.size(); ++k) {
+            old_positions_[k] = positions_[movable_[k]];
+            positions_[movable_[k]] = new_positions_[k];
+            moved_[movable_[k]] = 1;
+        }
+
+        bool rolled_back = true;
+        while (rolled_back) {
+            rolled_back = false;
+            for (std::size_t k = 0; k < movable_.size(); ++k) {
+                std::size_t i = movable_[k];
+                if (moved_[i] && has_inverted_face(k)) {
+                    positions_[i] = old_positions_[k];
+                    moved_[i] = 0;
+                    ++num_rollbacks_;
+                    rolled_back = true;
+                }
+            }
+        }
+
+        for (std::size_t k = 0; k < movable_.size(); ++k) {
+            if (moved_[movable_[k]]) {
+                nodes_[movable_[k]]->set_position(positions_[movable_[k]]);
+            }
+        }
+    }
+
+    bool has_inverted_face (std::size_t k) const {
+        Point2 const& p = positions_[movable_[k]];
+        std::size_t first = ring_starts_[k], last = ring_starts_[k + 1] - 1;
+        for (std::size_t j = first; j <= last; ++j) {
+            Point2 const& q1 = positions_[rings_[j]];
+            Point2 const& q2 = positions_[rings_[j < last ? j + 1 : first]];
+            if (Kernel::oriented_side(p, q1, q2) != ON_POSITIVE_SIDE) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Only the edges of the faces around the moved nodes can have lost the
+    // Delaunay property. An edge with a moved end is tested by the first
+    // such end, from the rings; its faces are those of the node with the
+    // neighbours before and after the other end. An edge with no moved end
+    // opposite to a moved node is tested by that node, and perhaps by the
+    // moved node on its other side too. Only the edges found non-Delaunay
+    // are passed to make_cdt().
+    void restore_delaunay (Tria &tria) {
+        std::vector<Edge_handle> edges, flipped;
+        for (std::size_t k = 0; k < movable_.size(); ++k) {
+            std::size_t i = movable_[k];
+            if (!moved_[i]) {
+                continue;
+            }
+            std::size_t first = ring_starts_[k], last = ring_starts_[k + 1] - 1;
+            Halfedge_handle he = nodes_[i]->halfedge();
+            for (std::size_t j = first; j <= last; ++j, he = he->prev()->pair()) {
+                std::size_t r = rings_[j];
+                std::size_t prev = rings_[j > first ? j - 1 : last];
+                std::size_t next = rings_[j < last ? j + 1 : first];
+                if (moved_[r] && r < i) {
+                    continue;
+                }
+                if (Kernel::oriented_circle(positions_[i], positions_[prev], positions_[r], positions_[next]) == ON_POSITIVE_SIDE) {
+                    edges.push_back(he->edge());
+                }
+                if (!moved_[r] && !moved_[next] && !he->next()->edge()->is_constrained_delaunay()) {
+                    edges.push_back(he->next()->edge());
+                }
+            }
+        }
+
+        if (!edges.empty()) {
+            tria.make_cdt(edges, flipped);
+        }
+        if (!flipped.empty()) {
+            update_rings(flipped);
+        }
+    }
+
+    Method                                            method_;
+    unsigned                                          num_threads_;
+    std::size_t                                       num_rollbacks_;
+    std::vector<Node_handle>                          nodes_;
+    boost::unordered_map<Node const*, std::size_t>    indices_;
+    std::vector<Point2>                               positions_;
+    std::vector<std::size_t>                          movable_;
+    // the position of each node in movable_, or NOT_MOVABLE
+    std::vector<std::size_t>                          slots_;
+    std::vector<std::size_t>                          ring_starts_;
+    std::vector<std::size_t>                          rings_;
+    std::vector<Point2>                               old_positions_;
+    std::vector<Point2>                               new_positions_;
+    std::vector<unsigned char>                        moved_;
+    std::vector<unsigned char>                        changed_;
+};
+
+template <typename Triangulation>
+std::size_t const Smoother<Triangulation>::NOT_MOVABLE;
+
+} // namespace umeshu
+
+#endif // UMESHU_SMOOTHER_H
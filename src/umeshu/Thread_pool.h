@@ -0,0 +1,152 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+#ifndef UMESHU_THREAD_POOL_H
+#define UMESHU_THREAD_POOL_H
+
+#include <boost/bind/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+
+namespace umeshu
+{
+
+// Worker threads kept alive between parallel sections, so that work done in
+// many short rounds does not pay for starting threads in each of them. run()
+// calls the job with the numbers 0, ..., size() - 1, the first one on the
+// calling thread and the others on the workers, and returns when all the
+// calls have returned. The jobs must not throw.
+class Thread_pool : private boost::noncopyable
+{
+public:
+  typedef boost::function<void ( unsigned )> Job;
+
+  explicit Thread_pool( unsigned size )
+    : size_( std::max( size, 1u ) )
+    , job_( NULL )
+    , round_( 0 )
+    , running_( 0 )
+    , stop_( false )
+  {
+    for ( unsigned t = 1; t < size_; ++t )
+    {
+      workers_.create_thread( boost::bind( &Thread_pool::work, this, t ) );
+    }
+  }
+
+  ~Thread_pool()
+  {
+    {
+      boost::mutex::scoped_lock lock( mutex_ );
+      stop_ = true;
+    }
+    start_.notify_all();
+    workers_.join_all();
+  }
+
+  unsigned size() const
+  {
+    return size_;
+  }
+
+  void run( Job const& job )
+  {
+    if ( size_ == 1 )
+    {
+      job( 0 );
+      return;
+    }
+
+    {
+      boost::mutex::scoped_lock lock( mutex_ );
+      job_ = &job;
+      running_ = size_ - 1;
+      ++round_;
+    }
+    start_.notify_all();
+
+    job( 0 );
+
+    boost::mutex::scoped_lock lock( mutex_ );
+
+    while ( running_ > 0 )
+    {
+      done_.wait( lock );
+    }
+
+    job_ = NULL;
+  }
+
+private:
+
+  void work( unsigned thread )
+  {
+    unsigned long round = 0;
+
+    while ( true )
+    {
+      Job const* job;
+      {
+        boost::mutex::scoped_lock lock( mutex_ );
+
+        while ( round_ == round && !stop_ )
+        {
+          start_.wait( lock );
+        }
+
+        if ( stop_ )
+        {
+          return;
+        }
+
+        round = round_;
+        job = job_;
+      }
+
+      ( *job )( thread );
+
+      boost::mutex::scoped_lock lock( mutex_ );
+
+      if ( --running_ == 0 )
+      {
+        done_.notify_one();
+      }
+    }
+  }
+
+  unsigned                  size_;
+  Job const*                job_;
+  unsigned long             round_;
+  unsigned                  running_;
+  bool                      stop_;
+  boost::mutex              mutex_;
+  boost::condition_variable start_, done_;
+  boost::thread_group       workers_;
+};
+
+} // namespace umeshu
+
+#endif // UMESHU_THREAD_POOL_H
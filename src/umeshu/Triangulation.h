@@ -32,6 +32,8 @@
 #include <boost/assert.hpp>
 #include <boost/pool/pool_alloc.hpp>
 
+#include <vector>
+
 namespace umeshu
 {
 
@@ -234,6 +236,139 @@ public:
     return n_new;
   }
 
+  // An edge can be collapsed into a node at p if the only nodes adjacent to
+  // both of its ends are the opposite nodes of its faces (the link
+  // condition), if it does not join two boundary nodes across the interior,
+  // if the opposite nodes are left with at least two edges, and if moving
+  // its ends to p inverts no face around them.
+  bool can_collapse_edge( Edge_handle e, Point2 const& p ) const
+  {
+    Halfedge_handle he = e->he1();
+    Node_handle n1 = he->origin();
+    Node_handle n2 = he->pair()->origin();
+
+    if ( !e->is_boundary() && n1->is_boundary() && n2->is_boundary() )
+    {
+      return false;
+    }
+
+    std::size_t num_faces = 0;
+
+    for ( int i = 0; i < 2; ++i, he = he->pair() )
+    {
+      if ( !he->is_boundary() )
+      {
+        ++num_faces;
+
+        if ( he->prev()->origin()->degree() < 3 )
+        {
+          return false;
+        }
+      }
+    }
+
+    std::size_t num_common = 0;
+    Halfedge_handle he_iter = n1->halfedge();
+
+    do
+    {
+      Node_handle n = he_iter->pair()->origin();
+
+      if ( n != n2 && find_halfedge( n, n2 ) != Halfedge_handle() )
+      {
+        ++num_common;
+      }
+
+      he_iter = he_iter->pair()->next();
+    }
+    while ( he_iter != n1->halfedge() );
+
+    return num_common == num_faces && keeps_orientation( n1, n2, p ) && keeps_orientation( n2, n1, p );
+  }
+
+  // Merges the ends of the edge into a node at p. The faces of the edge are
+  // removed and the node at its first halfedge's origin is kept.
+  Node_handle collapse_edge( Edge_handle e, Point2 const& p )
+  {
+    BOOST_ASSERT( can_collapse_edge( e, p ) );
+
+    Node_handle n1 = e->he1()->origin();
+    Node_handle n2 = e->he2()->origin();
+
+    // the edges opposite to n2 in counter-clockwise order, starting after
+    // the boundary if n2 is on it
+    std::vector<Halfedge_handle> link;
+    Halfedge_handle he_start = n2->boundary_halfedge();
+
+    if ( he_start == Halfedge_handle() )
+    {
+      he_start = n2->halfedge();
+    }
+
+    Halfedge_handle he_iter = he_start;
+
+    do
+    {
+      Halfedge_handle opposite = he_iter->next();
+
+      if ( !he_iter->is_boundary() && opposite->origin() != n1 && opposite->pair()->origin() != n1 )
+      {
+        link.push_back( opposite );
+      }
+
+      he_iter = he_iter->prev()->pair();
+    }
+    while ( he_iter != he_start );
+
+    remove_node( n2 );
+    n1->set_position( p );
+
+    for ( typename std::vector<Halfedge_handle>::const_iterator iter = link.begin(); iter != link.end(); ++iter )
+    {
+      Halfedge_handle to_origin = find_halfedge( n1, ( *iter )->origin() );
+
+      if ( to_origin == Halfedge_handle() )
+      {
+        to_origin = add_edge( n1, ( *iter )->origin() );
+      }
+
+      Halfedge_handle to_dest = find_halfedge( n1, ( *iter )->pair()->origin() );
+
+      if ( to_dest == Halfedge_handle() )
+      {
+        to_dest = add_edge( n1, ( *iter )->pair()->origin() );
+      }
+
+      add_face( *iter, to_dest->pair(), to_origin );
+    }
+
+    return n1;
+  }
+
+  // The halfedge going from n1 to n2, if there is one
+  Halfedge_handle find_halfedge( Node_handle n1, Node_handle n2 ) const
+  {
+    if ( n1->is_isolated() )
+    {
+      return Halfedge_handle();
+    }
+
+    Halfedge_handle he_iter = n1->halfedge();
+
+    do
+    {
+      if ( he_iter->pair()->origin() == n2 )
+      {
+        return he_iter;
+      }
+
+      he_iter = he_iter->pair()->next();
+    }
+    while ( he_iter != n1->halfedge() );
+
+    return Halfedge_handle();
+  }
+
   Bounding_box bounding_box() const
   {
     Bounding_box bbox = boost::geometry::make_inverse<Bounding_box>();
@@ -338,6 +473,32 @@ public:
 
 private:
 
+  // Whether the faces around n not incident to other stay positively
+  // oriented when n is moved to p
+  bool keeps_orientation( Node_handle n, Node_handle other, Point2 const& p ) const
+  {
+    Halfedge_handle he_iter = n->halfedge();
+
+    do
+    {
+      if ( !he_iter->is_boundary() )
+      {
+        Node_handle n2 = he_iter->pair()->origin();
+        Node_handle n3 = he_iter->prev()->origin();
+
+        if ( n2 != other && n3 != other && Kernel::oriented_side( p, n2->position(), n3->position() ) != ON_POSITIVE_SIDE )
+        {
+          return false;
+        }
+      }
+
+      he_iter = he_iter->pair()->next();
+    }
+    while ( he_iter != n->halfedge() );
+
+    return true;
+  }
+
   void attach_halfedge_to_node( Halfedge_handle he, Node_handle n )
   {
     he->set_origin( n );
@@ -371,7 +532,6 @@ private:
     Halfedge_handle b = in->next();
     Halfedge_handle d = out->prev();
 
-    Node_handle n = out->origin();
     Halfedge_handle g = find_free_incident_halfedge( out->pair(), in );
 
     Halfedge_handle h = g->next();
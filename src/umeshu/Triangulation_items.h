@@ -46,7 +46,7 @@ public:
 
   Triangulation_node_base()
     : Base()
-    , position_()
+    , position_( Point2::Zero() )
   {}
 
   explicit Triangulation_node_base( Point2 const& p )
@@ -227,13 +227,14 @@ public:
     {
       return false;
     }
-    // if ( Kernel::oriented_side( p1, p2, p3 ) != ON_POSITIVE_SIDE ||
-    //      Kernel::oriented_side( p2, p3, p4 ) != ON_POSITIVE_SIDE ||
-    //      Kernel::oriented_side( p3, p4, p1 ) != ON_POSITIVE_SIDE ||
-    //      Kernel::oriented_side( p4, p1, p2 ) != ON_POSITIVE_SIDE )
-    // {
-    //   return false;
-    // }
+
+    // the other diagonal has to separate the ends of this one, or the
+    // flipped faces would overlap
+    if ( Kernel::oriented_side( p2, p4, p3 ) != ON_NEGATIVE_SIDE ||
+         Kernel::oriented_side( p2, p4, p1 ) != ON_POSITIVE_SIDE )
+    {
+      return false;
+    }
 
     return true;
   }
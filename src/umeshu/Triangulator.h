@@ -29,6 +29,7 @@
 
 #include <boost/foreach.hpp>
 
+#include <iostream>
 #include <list>
 
 namespace umeshu
@@ -40,6 +41,7 @@ namespace internal
 template< typename Triangulation >
 class Add_point_to_triangulation
 {
+  typedef typename Triangulation::Kernel Kernel;
   typedef typename Triangulation::Node_handle Node_handle;
   typedef typename Triangulation::Halfedge_handle Halfedge_handle;
 
@@ -58,7 +60,7 @@ public:
     if ( tria->number_of_nodes() == 0 )
     {
       // we are adding the first point
-      first_node = tria->add_node( p );
+      first_node = tria->add_node( Kernel::snap( p ) );
       prev_node = first_node;
     }
     else if ( tria->number_of_nodes() == num_points - 1 )
@@ -68,7 +70,7 @@ public:
     }
     else
     {
-      Node_handle cur_node = tria->add_node( p );
+      Node_handle cur_node = tria->add_node( Kernel::snap( p ) );
       tria->add_edge( prev_node, cur_node );
       prev_node = cur_node;
     }
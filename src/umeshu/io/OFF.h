@@ -9,6 +9,9 @@
 #include <string>
 
 namespace umeshu {
+
+template <typename Triangulation> class Quad_dominant_mesh;
+
 namespace io {
 
 // enabled only for triangulations with ids
@@ -46,6 +49,41 @@ void write_off( std::string const& filename, Tria& tria,
   }
 }
 
+template< typename Tria >
+void write_off( std::string const& filename, Quad_dominant_mesh<Tria> const& mesh )
+{
+  namespace bg = boost::geometry;
+
+  std::ofstream out( filename.c_str() );
+
+  if ( out.fail() )
+  {
+    return;
+  }
+
+  out << "OFF\n";
+  out << "# " << filename << std::endl;
+  out << mesh.number_of_nodes() << " " << mesh.number_of_elements() << " " << mesh.number_of_edges() << std::endl;
+
+  for ( std::size_t node = 0; node < mesh.number_of_nodes(); ++node )
+  {
+    out << bg::get<0>( mesh.position( node ) ) << " " << bg::get<1>( mesh.position( node ) ) << " 0\n";
+  }
+
+  for ( std::size_t element = 0; element < mesh.number_of_elements(); ++element )
+  {
+    std::size_t const* nodes = mesh.element_nodes( element );
+    out << mesh.element_size( element );
+
+    for ( std::size_t i = 0; i < mesh.element_size( element ); ++i )
+    {
+      out << " " << nodes[i];
+    }
+
+    out << std::endl;
+  }
+}
+
 } // io
 } // umeshu
 
@@ -9,6 +9,9 @@
 #include <string>
 
 namespace umeshu {
+
+template <typename Triangulation> class Quad_dominant_mesh;
+
 namespace io {
 
 // enabled only for triangulations with ids
@@ -51,6 +54,46 @@ void write_ply( std::string const& filename, Tria& tria,
   }
 }
 
+template< typename Tria >
+void write_ply( std::string const& filename, Quad_dominant_mesh<Tria> const& mesh )
+{
+  namespace bg = boost::geometry;
+
+  std::ofstream out( filename.c_str() );
+
+  if ( out.fail() )
+  {
+    return;
+  }
+
+  out << "ply\n";
+  out << "format ascii 1.0\n";
+  out << "comment " << filename << " generated by umeshu-meshgen" << std::endl;
+  out << "element vertex " << mesh.number_of_nodes() << std::endl;
+  out << "property float x\nproperty float y\nproperty float z\n";
+  out << "element face " << mesh.number_of_elements() << std::endl;
+  out << "property list uchar int vertex_indices\n";
+  out << "end_header\n";
+
+  for ( std::size_t node = 0; node < mesh.number_of_nodes(); ++node )
+  {
+    out << bg::get<0>( mesh.position( node ) ) << " " << bg::get<1>( mesh.position( node ) ) << " 0\n";
+  }
+
+  for ( std::size_t element = 0; element < mesh.number_of_elements(); ++element )
+  {
+    std::size_t const* nodes = mesh.element_nodes( element );
+    out << mesh.element_size( element );
+
+    for ( std::size_t i = 0; i < mesh.element_size( element ); ++i )
+    {
+      out << " " << nodes[i];
+    }
+
+    out << std::endl;
+  }
+}
+
 } // io
 } // umeshu
 
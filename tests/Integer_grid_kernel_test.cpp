@@ -0,0 +1,83 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+#define BOOST_TEST_MODULE Integer_grid_kernel
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "Bounding_box.h"
+#include "Delaunay_mesher.h"
+#include "Delaunay_triangulation.h"
+#include "Delaunay_triangulation_items.h"
+#include "Integer_grid_kernel.h"
+#include "Polygon.h"
+#include "Triangulator.h"
+
+using namespace umeshu;
+
+typedef Delaunay_triangulation<Delaunay_triangulation_items, Integer_grid_kernel> Mesh;
+
+// The node coordinates followed by those of the vertices of each face
+static std::vector<double> mesh_polygon(Polygon const& boundary)
+{
+    Mesh mesh;
+    Triangulator<Mesh> triangulator;
+    triangulator.triangulate(boundary, mesh);
+    mesh.make_cdt();
+    Delaunay_mesher<Mesh> mesher;
+    mesher.refine(mesh, 0.0005, 25);
+
+    std::vector<double> coordinates;
+    for (Mesh::Node_iterator iter = mesh.nodes_begin(); iter != mesh.nodes_end(); ++iter) {
+        BOOST_CHECK(Integer_grid_kernel::snap(iter->position()) == iter->position());
+        coordinates.push_back(iter->position().x());
+        coordinates.push_back(iter->position().y());
+    }
+    for (Mesh::Face_iterator iter = mesh.faces_begin(); iter != mesh.faces_end(); ++iter) {
+        Point2 p1, p2, p3;
+        iter->vertices(p1, p2, p3);
+        coordinates.push_back(p1.x());
+        coordinates.push_back(p1.y());
+        coordinates.push_back(p2.x());
+        coordinates.push_back(p2.y());
+        coordinates.push_back(p3.x());
+        coordinates.push_back(p3.y());
+    }
+    return coordinates;
+}
+
+// The L-shape has many cocircular points and faces of equal quality, so the
+// result depends on the order in which they are treated
+BOOST_AUTO_TEST_CASE(same_mesh_twice)
+{
+    Polygon boundary;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 1,1 1,1 2,0 2,0 0.3,0.1 0.3,0.1 0.2,0 0.2,0 0))", boundary);
+    Bounding_box box;
+    boost::geometry::envelope(boundary, box);
+    Integer_grid_kernel::set_bounding_box(box);
+
+    std::vector<double> first = mesh_polygon(boundary);
+    std::vector<double> second = mesh_polygon(boundary);
+
+    BOOST_CHECK(!first.empty());
+    BOOST_CHECK(first == second);
+}
@@ -0,0 +1,148 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+#define BOOST_TEST_MODULE Kernel
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "Bounding_box.h"
+#include "Exact_adaptive_kernel.h"
+#include "Interval_kernel.h"
+#include "Predicates.h"
+#include "Semi_static_kernel.h"
+
+using namespace umeshu;
+
+static double random_number(double lo, double hi)
+{
+    return lo + (hi - lo) * (std::rand() / static_cast<double>(RAND_MAX));
+}
+
+// Whether both predicates of the kernel agree with the exact ones on the
+// query, with the first three points in the order given
+template <typename Kernel>
+static bool agrees_with_exact_kernel(Point2 const& pa, Point2 const& pb, Point2 const& pc, Point2 const& test)
+{
+    return Kernel::oriented_side(pa, pb, test) == Exact_adaptive_kernel::oriented_side(pa, pb, test) &&
+           Kernel::oriented_circle(pa, pb, pc, test) == Exact_adaptive_kernel::oriented_circle(pa, pb, pc, test);
+}
+
+// Random points in the unit square, as test points also outside of it,
+// near it and far
+template <typename Kernel>
+static void check_random_queries(std::size_t n)
+{
+    std::size_t num_mismatches = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        Point2 pa(random_number(0.0, 1.0), random_number(0.0, 1.0));
+        Point2 pb(random_number(0.0, 1.0), random_number(0.0, 1.0));
+        Point2 pc(random_number(0.0, 1.0), random_number(0.0, 1.0));
+        Point2 tests[] = { Point2(random_number(0.0, 1.0), random_number(0.0, 1.0)),
+                           Point2(random_number(-0.5, 1.5), random_number(-0.5, 1.5)),
+                           Point2(random_number(-100.0, 100.0), random_number(-100.0, 100.0)) };
+        for (int j = 0; j < 3; ++j) {
+            if (!agrees_with_exact_kernel<Kernel>(pa, pb, pc, tests[j])) {
+                ++num_mismatches;
+            }
+        }
+    }
+    BOOST_CHECK(num_mismatches == 0);
+}
+
+// Test points on a grid with the spacing of one ulp around a point on the
+// line through pa and pb and on the circle through pa, pb and pc, so that
+// the approximate determinants are mostly noise
+template <typename Kernel>
+static void check_nearly_degenerate_queries()
+{
+    Point2 pa(0.15, 0.2), pb(0.9, 0.825), pc(0.8, 0.1);
+    Point2 center = Exact_adaptive_kernel::circumcenter(pa, pb, pc);
+    double radius = (pa - center).norm();
+
+    double const ulp = std::ldexp(1.0, -53);
+    Point2 on_line = 0.5 * (pa + pb);
+    Point2 on_circle = center + radius * Point2(std::cos(1.0), std::sin(1.0));
+
+    std::size_t num_mismatches = 0;
+    for (int i = -32; i < 32; ++i) {
+        for (int j = -32; j < 32; ++j) {
+            Point2 offset(i * ulp, j * ulp);
+            if (!agrees_with_exact_kernel<Kernel>(pa, pb, pc, on_line + offset) ||
+                !agrees_with_exact_kernel<Kernel>(pa, pb, pc, on_circle + offset)) {
+                ++num_mismatches;
+            }
+        }
+    }
+    BOOST_CHECK(num_mismatches == 0);
+}
+
+BOOST_AUTO_TEST_CASE(semi_static_kernel)
+{
+    std::srand(1);
+
+    // without a box, all the queries go to the adaptive predicates
+    check_random_queries<Semi_static_kernel>(10000);
+
+    Semi_static_kernel::set_bounding_box(Bounding_box(Point2(0.0, 0.0), Point2(1.0, 1.0)));
+    check_random_queries<Semi_static_kernel>(500000);
+    check_nearly_degenerate_queries<Semi_static_kernel>();
+
+    // the other points at the corners of the padded box and the test point
+    // at the opposite one, just inside or just outside
+    Point2 lo(-0.25, -0.25), hi(1.25, 1.25);
+    Point2 a(-0.25, 1.25), b(1.25, -0.25);
+    Point2 delta(1e-15, 1e-15);
+    BOOST_CHECK(agrees_with_exact_kernel<Semi_static_kernel>(lo, a, b, hi));
+    BOOST_CHECK(agrees_with_exact_kernel<Semi_static_kernel>(lo, a, b, hi + delta));
+    BOOST_CHECK(agrees_with_exact_kernel<Semi_static_kernel>(lo, a, b, hi - delta));
+}
+
+BOOST_AUTO_TEST_CASE(interval_kernel)
+{
+    std::srand(2);
+    check_random_queries<Interval_kernel>(500000);
+    check_nearly_degenerate_queries<Interval_kernel>();
+}
+
+// The offsets of the circumcenters from the first point are compared with
+// those computed from exact expansions, also for nearly collinear points
+BOOST_AUTO_TEST_CASE(interval_kernel_circumcenter)
+{
+    std::srand(3);
+    double max_error = 0.0;
+    for (int i = 0; i < 10000; ++i) {
+        Point2 a(random_number(0.0, 1.0), random_number(0.0, 1.0));
+        Point2 b(random_number(0.0, 1.0), random_number(0.0, 1.0));
+        Point2 c = (i % 2 == 0) ? Point2(random_number(0.0, 1.0), random_number(0.0, 1.0))
+                                : Point2(0.5 * (a + b) + std::ldexp(random_number(-1.0, 1.0), -30) * Point2(a.y() - b.y(), b.x() - a.x()));
+        if (Exact_adaptive_kernel::oriented_side(a, b, c) == ON_ORIENTED_BOUNDARY) {
+            continue;
+        }
+        Point2 exact;
+        circumcenter_exact(a.data(), b.data(), c.data(), exact.data());
+        Point2 offset = Interval_kernel::circumcenter(a, b, c) - a;
+        max_error = std::max(max_error, (offset - exact).norm() / exact.norm());
+    }
+    BOOST_CHECK(max_error < 1e-12);
+}
@@ -0,0 +1,133 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+
+#define BOOST_TEST_MODULE Mesh_hierarchy
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+#include "Delaunay_mesher.h"
+#include "Delaunay_triangulation.h"
+#include "Delaunay_triangulation_items.h"
+#include "Mesh_hierarchy.h"
+#include "Polygon.h"
+#include "Triangulator.h"
+
+using namespace umeshu;
+
+typedef Delaunay_triangulation<Delaunay_triangulation_items> Mesh;
+typedef Mesh_hierarchy<Mesh>                                 Hierarchy;
+
+// L-shaped domain, so that some walks run into the reentrant corner
+static void triangulate_l_shape(Mesh& mesh)
+{
+    Polygon boundary;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 1,1 1,1 2,0 2,0 0))", boundary);
+    Triangulator<Mesh> triangulator;
+    triangulator.triangulate(boundary, mesh);
+    mesh.make_cdt();
+}
+
+static std::size_t level_of_node(Hierarchy const& hierarchy, std::size_t node)
+{
+    std::size_t level = 0;
+    while (node >= hierarchy.number_of_nodes(level)) {
+        ++level;
+    }
+    return level;
+}
+
+BOOST_AUTO_TEST_CASE(levels_of_refinement)
+{
+    Mesh mesh;
+    triangulate_l_shape(mesh);
+    Delaunay_mesher<Mesh> mesher;
+    Hierarchy hierarchy;
+    mesher.refine_levels(mesh, 0.01, 20, 3, hierarchy);
+
+    BOOST_CHECK(hierarchy.number_of_levels() == 3);
+    for (std::size_t level = 1; level < hierarchy.number_of_levels(); ++level) {
+        BOOST_CHECK(hierarchy.number_of_nodes(level) > hierarchy.number_of_nodes(level - 1));
+        BOOST_CHECK(hierarchy.number_of_faces(level) > hierarchy.number_of_faces(level - 1));
+    }
+    BOOST_CHECK(hierarchy.number_of_nodes(2) == mesh.number_of_nodes());
+    BOOST_CHECK(hierarchy.number_of_faces(2) == mesh.number_of_faces());
+
+    // the finest level is the mesh itself, node by node
+    std::size_t node = 0;
+    for (Mesh::Node_iterator iter = mesh.nodes_begin(); iter != mesh.nodes_end(); ++iter, ++node) {
+        BOOST_CHECK(iter->position() == hierarchy.position(node));
+    }
+
+    // every face of a level has positive area
+    for (std::size_t level = 0; level < hierarchy.number_of_levels(); ++level) {
+        std::vector<std::size_t> const& faces = hierarchy.faces(level);
+        for (std::size_t i = 0; i < faces.size(); i += 3) {
+            BOOST_CHECK(faces[i] < hierarchy.number_of_nodes(level));
+            BOOST_CHECK(faces[i + 1] < hierarchy.number_of_nodes(level));
+            BOOST_CHECK(faces[i + 2] < hierarchy.number_of_nodes(level));
+            BOOST_CHECK(Mesh::Kernel::signed_area(hierarchy.position(faces[i]), hierarchy.position(faces[i + 1]), hierarchy.position(faces[i + 2])) > 0.0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parents_interpolate_positions)
+{
+    Mesh mesh;
+    triangulate_l_shape(mesh);
+    Delaunay_mesher<Mesh> mesher;
+    Hierarchy hierarchy;
+    mesher.refine_levels(mesh, 0.01, 20, 3, hierarchy);
+
+    for (std::size_t node = hierarchy.number_of_nodes(0); node < hierarchy.number_of_nodes(2); ++node) {
+        Hierarchy::Parent const& parent = hierarchy.parent(node);
+        std::size_t coarse = level_of_node(hierarchy, node) - 1;
+        std::vector<std::size_t> const& faces = hierarchy.faces(coarse);
+
+        BOOST_REQUIRE(parent.face < hierarchy.number_of_faces(coarse));
+        double sum = 0.0;
+        Point2 p = Point2::Zero();
+        for (int i = 0; i < 3; ++i) {
+            BOOST_CHECK(parent.nodes[i] == faces[3 * parent.face + i]);
+            BOOST_CHECK(parent.weights[i] > -1e-9);
+            sum += parent.weights[i];
+            p += parent.weights[i] * hierarchy.position(parent.nodes[i]);
+        }
+        BOOST_CHECK(std::abs(sum - 1.0) < 1e-12);
+        BOOST_CHECK((p - hierarchy.position(node)).norm() < 1e-12);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(unchanged_level)
+{
+    Mesh mesh;
+    triangulate_l_shape(mesh);
+    Hierarchy hierarchy;
+    hierarchy.add_level(mesh);
+    hierarchy.add_level(mesh);
+
+    BOOST_CHECK(hierarchy.number_of_levels() == 2);
+    BOOST_CHECK(hierarchy.number_of_nodes(1) == hierarchy.number_of_nodes(0));
+    BOOST_CHECK(hierarchy.faces(1) == hierarchy.faces(0));
+
+    hierarchy.clear();
+    BOOST_CHECK(hierarchy.number_of_levels() == 0);
+}
@@ -21,11 +21,22 @@
 
 #define BOOST_TEST_MODULE Triangulation
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
 #include <cmath>
 
-#include "io/Postscript_ostream.h"
+#include "io/EPS.h"
+#include "Delaunay_mesher.h"
+#include "Delaunay_triangulation.h"
+#include "Delaunay_triangulation_items.h"
+#include "Domain_decomposition_mesher.h"
+#include "Polygon.h"
+#include "Quad_dominant_mesh.h"
+#include "Relaxer.h"
+#include "Smoother.h"
 #include "Triangulation_items.h"
 #include "Triangulation.h"
+#include "Triangulator.h"
+#include "Utils.h"
 
 using namespace umeshu;
 
@@ -35,6 +46,9 @@ typedef Tria::Halfedge_handle         Halfedge_handle;
 typedef Tria::Edge_handle             Edge_handle;
 typedef Tria::Face_handle             Face_handle;
 
+typedef Delaunay_triangulation<Delaunay_triangulation_items> Mesh;
+typedef Delaunay_triangulation<Delaunay_triangulation_items_with_id> Mesh_with_id;
+
 BOOST_AUTO_TEST_CASE(construction_and_access)
 {
     Tria tria;
@@ -130,8 +144,7 @@ BOOST_AUTO_TEST_CASE(insertion_in_edge)
     BOOST_CHECK(tria.number_of_faces() == 2);
 
     {
-        io::Postscript_ostream ps("split_edge_1.eps", tria.bounding_box());
-        ps << tria;
+        io::write_eps("split_edge_1.eps", tria);
     }
     tria.split_edge(h5->edge(), Point2(0.5,0.5));
     BOOST_CHECK(tria.number_of_nodes() == 5);
@@ -139,7 +152,578 @@ BOOST_AUTO_TEST_CASE(insertion_in_edge)
     BOOST_CHECK(tria.number_of_edges() == 8);
     BOOST_CHECK(tria.number_of_faces() == 4);
     {
-        io::Postscript_ostream ps("split_edge_2.eps", tria.bounding_box());
-        ps << tria;
+        io::write_eps("split_edge_2.eps", tria);
+    }
+}
+
+// A mesh of the square [0,2]x[0,2] with interior nodes
+static void refine_square(Mesh& mesh)
+{
+    Polygon boundary;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 2,0 2,0 0))", boundary);
+    Triangulator<Mesh> triangulator;
+    triangulator.triangulate(boundary, mesh);
+    mesh.make_cdt();
+    Delaunay_mesher<Mesh> mesher;
+    mesher.refine(mesh, 0.05, 25);
+}
+
+// The halfedges are linked consistently, the faces are positively oriented
+// and the mesh is a topological disk.
+template <typename T>
+static bool is_valid(T const& tria)
+{
+    for (typename T::Face_const_iterator iter = tria.faces_begin(); iter != tria.faces_end(); ++iter) {
+        typename T::Halfedge_handle he = iter->halfedge();
+        if (he->next()->next()->next() != he || he->prev() != he->next()->next()) {
+            return false;
+        }
+        if (he->face() != he->next()->face() || he->face() != he->prev()->face()) {
+            return false;
+        }
+        Point2 p1, p2, p3;
+        iter->vertices(p1, p2, p3);
+        if (T::Kernel::signed_area(p1, p2, p3) <= 0.0) {
+            return false;
+        }
+    }
+    for (typename T::Edge_const_iterator iter = tria.edges_begin(); iter != tria.edges_end(); ++iter) {
+        if (iter->he1()->pair() != iter->he2() || iter->he2()->pair() != iter->he1()) {
+            return false;
+        }
+        if (iter->he1()->origin() == iter->he2()->origin()) {
+            return false;
+        }
+    }
+    for (typename T::Node_const_iterator iter = tria.nodes_begin(); iter != tria.nodes_end(); ++iter) {
+        typename T::Halfedge_handle he = iter->halfedge();
+        std::size_t degree = 0;
+        do {
+            if (he->origin()->position() != iter->position() || ++degree > tria.number_of_edges()) {
+                return false;
+            }
+            he = he->pair()->next();
+        } while (he != iter->halfedge());
+    }
+    long euler = static_cast<long>(tria.number_of_nodes()) - static_cast<long>(tria.number_of_edges()) + static_cast<long>(tria.number_of_faces());
+    return euler == 1;
+}
+
+static bool is_constrained_delaunay(Mesh const& mesh)
+{
+    for (Mesh::Edge_const_iterator iter = mesh.edges_begin(); iter != mesh.edges_end(); ++iter) {
+        if (!iter->is_constrained_delaunay()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(removal_of_interior_node)
+{
+    Mesh mesh;
+    refine_square(mesh);
+    BOOST_REQUIRE(is_valid(mesh));
+    BOOST_REQUIRE(is_constrained_delaunay(mesh));
+
+    Mesh::Node_handle n = mesh.nodes_end();
+    for (Mesh::Node_iterator iter = mesh.nodes_begin(); iter != mesh.nodes_end(); ++iter) {
+        if (!iter->is_boundary()) {
+            n = iter;
+            break;
+        }
+    }
+    BOOST_REQUIRE(n != mesh.nodes_end());
+    BOOST_CHECK(mesh.is_removable(n));
+
+    Mesh::Node_handle first = mesh.nodes_begin();
+    Point2 first_position = first->position();
+    std::size_t num_nodes = mesh.number_of_nodes();
+    std::size_t num_faces = mesh.number_of_faces();
+    mesh.remove(n);
+
+    BOOST_CHECK(mesh.number_of_nodes() == num_nodes - 1);
+    BOOST_CHECK(mesh.number_of_faces() == num_faces - 2);
+    BOOST_CHECK(first->position() == first_position);
+    BOOST_CHECK(is_valid(mesh));
+    BOOST_CHECK(is_constrained_delaunay(mesh));
+}
+
+BOOST_AUTO_TEST_CASE(removal_of_boundary_node)
+{
+    Mesh mesh;
+    refine_square(mesh);
+
+    // a node splitting a side of the square
+    Mesh::Node_handle n = mesh.nodes_end();
+    for (Mesh::Node_iterator iter = mesh.nodes_begin(); iter != mesh.nodes_end(); ++iter) {
+        Point2 const& p = iter->position();
+        if (p.y() == 0.0 && p.x() > 0.0 && p.x() < 2.0) {
+            n = iter;
+            break;
+        }
+    }
+    BOOST_REQUIRE(n != mesh.nodes_end());
+    BOOST_REQUIRE(mesh.is_removable(n));
+
+    Mesh::Halfedge_handle he = n->boundary_halfedge();
+    BOOST_REQUIRE(he != Mesh::Halfedge_handle());
+    Mesh::Node_handle a = he->pair()->origin();
+    Mesh::Node_handle b = he->prev()->origin();
+
+    std::size_t num_nodes = mesh.number_of_nodes();
+    std::size_t num_faces = mesh.number_of_faces();
+    mesh.remove(n);
+
+    BOOST_CHECK(mesh.number_of_nodes() == num_nodes - 1);
+    BOOST_CHECK(mesh.number_of_faces() == num_faces - 1);
+    Mesh::Halfedge_handle ab = mesh.find_halfedge(a, b);
+    BOOST_REQUIRE(ab != Mesh::Halfedge_handle());
+    BOOST_CHECK(ab->edge()->is_boundary());
+    BOOST_CHECK(is_valid(mesh));
+    BOOST_CHECK(is_constrained_delaunay(mesh));
+}
+
+BOOST_AUTO_TEST_CASE(removal_of_constrained_node)
+{
+    Mesh mesh;
+    Polygon boundary;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 2,0 2,0 0))", boundary);
+    Triangulator<Mesh> triangulator;
+    triangulator.triangulate(boundary, mesh);
+
+    // constrain the diagonal and split it in the middle
+    Mesh::Edge_handle diagonal = mesh.edges_end();
+    for (Mesh::Edge_iterator iter = mesh.edges_begin(); iter != mesh.edges_end(); ++iter) {
+        if (!iter->is_boundary()) {
+            diagonal = iter;
+        }
+    }
+    BOOST_REQUIRE(diagonal != mesh.edges_end());
+    Mesh::Node_handle a = diagonal->he1()->origin();
+    Mesh::Node_handle b = diagonal->he2()->origin();
+    Mesh::Node_handle n = mesh.split_edge(diagonal, 0.5 * (a->position() + b->position()));
+    mesh.find_halfedge(n, a)->edge()->set_constrained(true);
+    mesh.find_halfedge(n, b)->edge()->set_constrained(true);
+
+    Point2 const points[] = { Point2(1.5, 0.4), Point2(0.4, 1.5), Point2(1.6, 1.3), Point2(0.3, 0.7) };
+    for (int i = 0; i < 4; ++i) {
+        mesh.insert(points[i]);
+    }
+    BOOST_REQUIRE(is_valid(mesh));
+    BOOST_REQUIRE(is_constrained_delaunay(mesh));
+    BOOST_CHECK(mesh.find_halfedge(n, a) != Mesh::Halfedge_handle());
+    BOOST_CHECK(mesh.find_halfedge(n, b) != Mesh::Halfedge_handle());
+
+    // a node ending a constrained edge cannot be removed
+    mesh.find_halfedge(n, b)->edge()->set_constrained(false);
+    BOOST_CHECK(!mesh.is_removable(n));
+    mesh.find_halfedge(n, b)->edge()->set_constrained(true);
+    BOOST_REQUIRE(mesh.is_removable(n));
+
+    std::size_t num_nodes = mesh.number_of_nodes();
+    std::size_t num_faces = mesh.number_of_faces();
+    mesh.remove(n);
+
+    BOOST_CHECK(mesh.number_of_nodes() == num_nodes - 1);
+    BOOST_CHECK(mesh.number_of_faces() == num_faces - 2);
+    Mesh::Halfedge_handle ab = mesh.find_halfedge(a, b);
+    BOOST_REQUIRE(ab != Mesh::Halfedge_handle());
+    BOOST_CHECK(ab->edge()->is_constrained());
+    BOOST_CHECK(is_valid(mesh));
+    BOOST_CHECK(is_constrained_delaunay(mesh));
+}
+
+BOOST_AUTO_TEST_CASE(collapse_blocked_by_link_condition)
+{
+    // triangle with a node inside: the boundary edge n1-n2 has one face, but
+    // its ends have two common neighbours
+    Tria tria;
+    Node_handle n1 = tria.add_node(Point2(0.0, 0.0));
+    Node_handle n2 = tria.add_node(Point2(4.0, 0.0));
+    Node_handle n3 = tria.add_node(Point2(2.0, 4.0));
+    Node_handle n4 = tria.add_node(Point2(2.0, 1.5));
+    Halfedge_handle h12 = tria.add_edge(n1, n2);
+    Halfedge_handle h23 = tria.add_edge(n2, n3);
+    Halfedge_handle h31 = tria.add_edge(n3, n1);
+    Halfedge_handle h14 = tria.add_edge(n1, n4);
+    Halfedge_handle h24 = tria.add_edge(n2, n4);
+    Halfedge_handle h34 = tria.add_edge(n3, n4);
+    tria.add_face(h12, h24, h14->pair());
+    tria.add_face(h23, h34, h24->pair());
+    tria.add_face(h31, h14, h34->pair());
+    BOOST_REQUIRE(is_valid(tria));
+
+    BOOST_CHECK(!tria.can_collapse_edge(h12->edge(), Point2(2.0, 0.0)));
+    BOOST_CHECK(!tria.can_collapse_edge(h23->edge(), Point2(3.0, 2.0)));
+    BOOST_CHECK(!tria.can_collapse_edge(h31->edge(), Point2(1.0, 2.0)));
+}
+
+BOOST_AUTO_TEST_CASE(collapse_of_interior_edge)
+{
+    Mesh mesh;
+    refine_square(mesh);
+
+    Mesh::Edge_handle e = mesh.edges_end();
+    Point2 p;
+    for (Mesh::Edge_iterator iter = mesh.edges_begin(); iter != mesh.edges_end(); ++iter) {
+        Mesh::Node_handle n1 = iter->he1()->origin();
+        Mesh::Node_handle n2 = iter->he2()->origin();
+        p = 0.5 * (n1->position() + n2->position());
+        if (!n1->is_boundary() && !n2->is_boundary() && mesh.can_collapse_edge(iter, p)) {
+            e = iter;
+            break;
+        }
+    }
+    BOOST_REQUIRE(e != mesh.edges_end());
+
+    // moving the merged node far away would invert faces
+    BOOST_CHECK(!mesh.can_collapse_edge(e, Point2(10.0, 10.0)));
+
+    Mesh::Node_handle kept = e->he1()->origin();
+    std::size_t num_nodes = mesh.number_of_nodes();
+    std::size_t num_edges = mesh.number_of_edges();
+    std::size_t num_faces = mesh.number_of_faces();
+    Mesh::Node_handle n = mesh.collapse_edge(e, p);
+
+    BOOST_CHECK(n == kept);
+    BOOST_CHECK(n->position() == p);
+    BOOST_CHECK(mesh.number_of_nodes() == num_nodes - 1);
+    BOOST_CHECK(mesh.number_of_edges() == num_edges - 3);
+    BOOST_CHECK(mesh.number_of_faces() == num_faces - 2);
+    BOOST_CHECK(is_valid(mesh));
+
+    // flipping restores the Delaunay property
+    mesh.make_cdt();
+    BOOST_CHECK(is_valid(mesh));
+    BOOST_CHECK(is_constrained_delaunay(mesh));
+}
+
+BOOST_AUTO_TEST_CASE(diagonal_of_non_convex_quadrilateral)
+{
+    // dart with the reflex corner at n3: the nodes opposite to the diagonal
+    // n1-n3 lie on both sides of it, but the faces after flipping it to
+    // n2-n4 would overlap
+    Tria tria;
+    Node_handle n1 = tria.add_node(Point2(0.0, 0.0));
+    Node_handle n2 = tria.add_node(Point2(4.0, 0.0));
+    Node_handle n3 = tria.add_node(Point2(1.0, 1.0));
+    Node_handle n4 = tria.add_node(Point2(0.0, 4.0));
+    Halfedge_handle h12 = tria.add_edge(n1, n2);
+    Halfedge_handle h23 = tria.add_edge(n2, n3);
+    Halfedge_handle h34 = tria.add_edge(n3, n4);
+    Halfedge_handle h41 = tria.add_edge(n4, n1);
+    Halfedge_handle h31 = tria.add_edge(n3, n1);
+    tria.add_face(h12, h23, h31);
+    tria.add_face(h34, h41, h31->pair());
+    BOOST_REQUIRE(is_valid(tria));
+
+    BOOST_CHECK(!h31->edge()->is_diagonal_of_convex_quadrilateral());
+
+    // with n3 moved out the quadrilateral is convex
+    n3->set_position(Point2(3.0, 3.0));
+    BOOST_CHECK(h31->edge()->is_diagonal_of_convex_quadrilateral());
+}
+
+template <typename T>
+static double total_area(T const& mesh)
+{
+    double area = 0.0;
+    for (typename T::Face_const_iterator iter = mesh.faces_begin(); iter != mesh.faces_end(); ++iter) {
+        Point2 p1, p2, p3;
+        iter->vertices(p1, p2, p3);
+        area += T::Kernel::signed_area(p1, p2, p3);
+    }
+    return area;
+}
+
+static bool meets_quality_bounds(Mesh const& mesh, double max_area, double min_angle)
+{
+    for (Mesh::Face_const_iterator iter = mesh.faces_begin(); iter != mesh.faces_end(); ++iter) {
+        Point2 p1, p2, p3;
+        iter->vertices(p1, p2, p3);
+        double a1, a2, a3;
+        Mesh::Kernel::triangle_angles(p1, p2, p3, a1, a2, a3);
+        if (Mesh::Kernel::signed_area(p1, p2, p3) > max_area || std::min(a1, std::min(a2, a3)) < utils::degrees_to_radians(min_angle)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(refinement_with_threads)
+{
+    Polygon boundary;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 1,1 1,1 2,0 2,0 0.3,0.1 0.3,0.1 0.2,0 0.2,0 0))", boundary);
+
+    Mesh meshes[2];
+    unsigned const num_threads[2] = { 1, 4 };
+    for (int i = 0; i < 2; ++i) {
+        Triangulator<Mesh> triangulator;
+        triangulator.triangulate(boundary, meshes[i]);
+        meshes[i].make_cdt();
+        Delaunay_mesher<Mesh> mesher;
+        mesher.set_num_threads(num_threads[i]);
+        mesher.refine(meshes[i], 0.001, 25);
+
+        BOOST_CHECK(is_valid(meshes[i]));
+        BOOST_CHECK(is_constrained_delaunay(meshes[i]));
+        BOOST_CHECK(meets_quality_bounds(meshes[i], 0.001, 25));
+    }
+
+    // the insertions differ, but the meshes cover the same domain with
+    // about as many nodes
+    BOOST_CHECK(std::abs(total_area(meshes[1]) - total_area(meshes[0])) < 1e-12);
+    BOOST_CHECK(meshes[1].number_of_nodes() > 0.9 * meshes[0].number_of_nodes());
+    BOOST_CHECK(meshes[1].number_of_nodes() < 1.1 * meshes[0].number_of_nodes());
+}
+
+static double boundary_length(Mesh& mesh)
+{
+    double length = 0.0;
+    Mesh::Halfedge_handle bhe = mesh.boundary_halfedge();
+    Mesh::Halfedge_handle he = bhe;
+    do {
+        length += (he->pair()->origin()->position() - he->origin()->position()).norm();
+        he = he->next();
+    } while (he != bhe);
+    return length;
+}
+
+BOOST_AUTO_TEST_CASE(domain_decomposition)
+{
+    Polygon boundary;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 1,1 1,1 2,0 2,0 0.3,0.1 0.3,0.1 0.2,0 0.2,0 0))", boundary);
+
+    Mesh mesh;
+    Domain_decomposition_mesher<Mesh> dd_mesher;
+    dd_mesher.set_num_subdomains(3);
+    dd_mesher.set_num_threads(2);
+    dd_mesher.mesh(boundary, mesh, 0.005, 25);
+
+    // a node on a cut missing on one side would leave a slit along the cut,
+    // i.e. a hole in the mesh and extra boundary
+    BOOST_CHECK(is_valid(mesh));
+    BOOST_CHECK(std::abs(total_area(mesh) - boost::geometry::area(boundary)) < 1e-12);
+    BOOST_CHECK(std::abs(boundary_length(mesh) - boost::geometry::perimeter(boundary)) < 1e-12);
+    BOOST_CHECK(is_constrained_delaunay(mesh));
+    BOOST_CHECK(meets_quality_bounds(mesh, 0.005, 25));
+
+    Polygon with_hole;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 2,0 2,0 0),(0.5 0.5,0.5 1.5,1.5 1.5,1.5 0.5,0.5 0.5))", with_hole);
+    Mesh other;
+    BOOST_CHECK_THROW(dd_mesher.mesh(with_hole, other, 0.005, 25), Domain_decomposition_mesher<Mesh>::domain_decomposition_error);
+}
+
+// The number of nodes of each degree
+template <typename T>
+static std::vector<std::size_t> degree_histogram(T const& tria)
+{
+    std::vector<std::size_t> histogram;
+    for (typename T::Node_const_iterator iter = tria.nodes_begin(); iter != tria.nodes_end(); ++iter) {
+        std::size_t degree = iter->degree();
+        if (degree >= histogram.size()) {
+            histogram.resize(degree + 1, 0);
+        }
+        ++histogram[degree];
+    }
+    return histogram;
+}
+
+BOOST_AUTO_TEST_CASE(relaxation_with_threads)
+{
+    Polygon boundary;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 1,1 1,1 2,0 2,0 0.3,0.1 0.3,0.1 0.2,0 0.2,0 0))", boundary);
+
+    Mesh_with_id meshes[2];
+    unsigned const num_threads[2] = { 1, 4 };
+    for (int i = 0; i < 2; ++i) {
+        Triangulator<Mesh_with_id> triangulator;
+        triangulator.triangulate(boundary, meshes[i]);
+        meshes[i].make_cdt();
+        Delaunay_mesher<Mesh_with_id> mesher;
+        mesher.refine(meshes[i], 0.001, 25);
+
+        std::size_t num_edges = meshes[i].number_of_edges();
+        double area = total_area(meshes[i]);
+
+        // enough edges for the flips to be done in rounds
+        BOOST_REQUIRE(num_edges > 256);
+
+        std::size_t id = 1000;
+        for (Mesh_with_id::Node_iterator iter = meshes[i].nodes_begin(); iter != meshes[i].nodes_end(); ++iter) {
+            iter->set_id(id++);
+        }
+
+        Relaxer<Mesh_with_id> relaxer;
+        relaxer.set_num_threads(num_threads[i]);
+        relaxer.relax(meshes[i]);
+
+        // the relaxer numbers the nodes through their ids, but must give
+        // them back
+        bool ids_kept = true;
+        id = 1000;
+        for (Mesh_with_id::Node_iterator iter = meshes[i].nodes_begin(); iter != meshes[i].nodes_end(); ++iter) {
+            ids_kept = ids_kept && iter->id() == id++;
+        }
+        BOOST_CHECK(ids_kept);
+
+        BOOST_CHECK(is_valid(meshes[i]));
+        BOOST_CHECK(meshes[i].number_of_edges() == num_edges);
+        BOOST_CHECK(std::abs(total_area(meshes[i]) - area) < 1e-12);
+    }
+
+    // the rounds are the same for any number of threads
+    BOOST_CHECK(degree_histogram(meshes[1]) == degree_histogram(meshes[0]));
+}
+
+BOOST_AUTO_TEST_CASE(smoothing)
+{
+    Polygon boundary;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 1,1 1,1 2,0 2,0 0.3,0.1 0.3,0.1 0.2,0 0.2,0 0))", boundary);
+
+    Smoother<Mesh>::Method const methods[2] = { Smoother<Mesh>::ODT, Smoother<Mesh>::CVT };
+    for (int m = 0; m < 2; ++m) {
+        Mesh mesh;
+        Triangulator<Mesh> triangulator;
+        triangulator.triangulate(boundary, mesh);
+        mesh.make_cdt();
+        Delaunay_mesher<Mesh> mesher;
+        mesher.refine(mesh, 0.005, 25);
+
+        // an interior edge is constrained, so its ends must stay too
+        Mesh::Edge_iterator constrained = mesh.edges_begin();
+        while (constrained->he1()->origin()->is_boundary() || constrained->he2()->origin()->is_boundary()) {
+            ++constrained;
+        }
+        constrained->set_constrained(true);
+
+        std::vector<Mesh::Node_handle> fixed_nodes;
+        std::vector<Point2> fixed_positions, positions;
+        for (Mesh::Node_iterator iter = mesh.nodes_begin(); iter != mesh.nodes_end(); ++iter) {
+            if (iter->is_boundary() || iter == constrained->he1()->origin() || iter == constrained->he2()->origin()) {
+                fixed_nodes.push_back(iter);
+                fixed_positions.push_back(iter->position());
+            }
+            positions.push_back(iter->position());
+        }
+
+        Smoother<Mesh> smoother;
+        smoother.set_method(methods[m]);
+        smoother.set_num_threads(2);
+        smoother.smooth(mesh, 5);
+
+        BOOST_CHECK(is_valid(mesh));
+        BOOST_CHECK(is_constrained_delaunay(mesh));
+        BOOST_CHECK(constrained->is_constrained());
+
+        bool fixed_kept = true;
+        for (std::size_t i = 0; i < fixed_nodes.size(); ++i) {
+            fixed_kept = fixed_kept && fixed_nodes[i]->position() == fixed_positions[i];
+        }
+        BOOST_CHECK(fixed_kept);
+
+        std::size_t num_moved = 0, i = 0;
+        for (Mesh::Node_iterator iter = mesh.nodes_begin(); iter != mesh.nodes_end(); ++iter, ++i) {
+            num_moved += iter->position() != positions[i];
+        }
+        BOOST_CHECK(num_moved > 0);
+    }
+}
+
+typedef Quad_dominant_mesh<Mesh> Quad_mesh;
+
+static Point2 element_corner(Quad_mesh const& quads, std::size_t element, std::size_t i)
+{
+    return quads.position(quads.element_nodes(element)[i % quads.element_size(element)]);
+}
+
+// All angles of the element turn left
+static bool is_convex_element(Quad_mesh const& quads, std::size_t element)
+{
+    for (std::size_t i = 0; i < quads.element_size(element); ++i) {
+        Point2 p1 = element_corner(quads, element, i);
+        Point2 p2 = element_corner(quads, element, i + 1);
+        Point2 p3 = element_corner(quads, element, i + 2);
+        if (Mesh::Kernel::oriented_side(p1, p2, p3) != ON_POSITIVE_SIDE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether p lies strictly inside the convex element
+static bool element_contains(Quad_mesh const& quads, std::size_t element, Point2 const& p)
+{
+    for (std::size_t i = 0; i < quads.element_size(element); ++i) {
+        if (Mesh::Kernel::oriented_side(element_corner(quads, element, i), element_corner(quads, element, i + 1), p) != ON_POSITIVE_SIDE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static double total_area(Quad_mesh const& quads)
+{
+    double area = 0.0;
+    for (std::size_t element = 0; element < quads.number_of_elements(); ++element) {
+        for (std::size_t i = 0; i < quads.element_size(element); ++i) {
+            Point2 p1 = element_corner(quads, element, i);
+            Point2 p2 = element_corner(quads, element, i + 1);
+            area += 0.5 * (p1.x() * p2.y() - p2.x() * p1.y());
+        }
+    }
+    return area;
+}
+
+BOOST_AUTO_TEST_CASE(quad_dominant_mesh)
+{
+    Polygon boundary;
+    boost::geometry::read_wkt("POLYGON((0 0,2 0,2 1,1 1,1 2,0 2,0 0.3,0.1 0.3,0.1 0.2,0 0.2,0 0))", boundary);
+
+    Mesh mesh;
+    Triangulator<Mesh> triangulator;
+    triangulator.triangulate(boundary, mesh);
+    mesh.make_cdt();
+    Delaunay_mesher<Mesh> mesher;
+    mesher.refine(mesh, 0.01, 25);
+
+    Quad_mesh quads;
+    quads.pair_triangles(mesh);
+
+    BOOST_CHECK(quads.number_of_quads() > 0);
+    BOOST_CHECK(quads.number_of_triangles() + 2 * quads.number_of_quads() == mesh.number_of_faces());
+    BOOST_CHECK(std::abs(total_area(quads) - total_area(mesh)) < 1e-12);
+
+    // each triangle lies in exactly one element, i.e., it is paired at
+    // most once
+    bool paired_once = true;
+    for (Mesh::Face_const_iterator iter = mesh.faces_begin(); iter != mesh.faces_end(); ++iter) {
+        Point2 p1, p2, p3;
+        iter->vertices(p1, p2, p3);
+        Point2 centroid = (p1 + p2 + p3) / 3.0;
+        std::size_t num_elements = 0;
+        for (std::size_t element = 0; element < quads.number_of_elements(); ++element) {
+            num_elements += element_contains(quads, element, centroid);
+        }
+        paired_once = paired_once && num_elements == 1;
+    }
+    BOOST_CHECK(paired_once);
+
+    bool convex = true;
+    for (std::size_t element = 0; element < quads.number_of_elements(); ++element) {
+        convex = convex && is_convex_element(quads, element);
+    }
+    BOOST_CHECK(convex);
+
+    quads.split_into_quads();
+
+    BOOST_CHECK(quads.number_of_triangles() == 0);
+    BOOST_CHECK(std::abs(total_area(quads) - total_area(mesh)) < 1e-12);
+
+    convex = true;
+    for (std::size_t element = 0; element < quads.number_of_elements(); ++element) {
+        convex = convex && quads.element_size(element) == 4 && is_convex_element(quads, element);
     }
+    BOOST_CHECK(convex);
 }
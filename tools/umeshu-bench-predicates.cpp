@@ -0,0 +1,248 @@
+//
+//  Copyright (c) 2013 Vladimir Chalupecky
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+
+#include <umeshu/Delaunay_mesher.h>
+#include <umeshu/Delaunay_triangulation.h>
+#include <umeshu/Delaunay_triangulation_items.h>
+#include <umeshu/Exact_adaptive_kernel.h>
+#include <umeshu/Fast_inexact_kernel.h>
+#include <umeshu/Integer_grid_kernel.h>
+#include <umeshu/Interval_kernel.h>
+#include <umeshu/Polygon.h>
+#include <umeshu/Semi_static_kernel.h>
+#include <umeshu/Triangulator.h>
+
+#include <boost/geometry/algorithms/envelope.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace umeshu;
+namespace po = boost::program_options;
+
+namespace
+{
+
+// Random points in the unit square; a fraction of them is put on a common
+// line and a common circle, so that the adaptive stages are exercised too.
+std::vector<Point2> random_points( std::size_t n, double degenerate )
+{
+  std::vector<Point2> points( n, Point2::Zero() );
+
+  for ( std::size_t i = 0; i < n; ++i )
+  {
+    double u = std::rand() / static_cast<double>( RAND_MAX );
+    double v = std::rand() / static_cast<double>( RAND_MAX );
+
+    if ( std::rand() / static_cast<double>( RAND_MAX ) < degenerate )
+    {
+      points[i] = ( i % 2 == 0 ) ? Point2( u, u ) : Point2( 0.5 + 0.5 * std::cos( 6.0 * u ), 0.5 + 0.5 * std::sin( 6.0 * u ) );
+    }
+    else
+    {
+      points[i] = Point2( u, v );
+    }
+  }
+
+  return points;
+}
+
+double seconds_since( std::clock_t start )
+{
+  return static_cast<double>( std::clock() - start ) / CLOCKS_PER_SEC;
+}
+
+// Prints the time and, unless baseline is zero, its ratio to the baseline;
+// returns the time.
+double report( char const* name, double seconds, std::size_t num_queries, long checksum, double baseline )
+{
+  std::cout << std::left << std::setw( 32 ) << name
+            << std::right << std::setw( 10 ) << std::fixed << std::setprecision( 3 ) << seconds << " s"
+            << std::setw( 10 ) << std::setprecision( 2 ) << 1e9 * seconds / num_queries << " ns/query";
+
+  if ( baseline > 0.0 )
+  {
+    std::cout << std::setw( 8 ) << std::setprecision( 2 ) << seconds / baseline << "x";
+  }
+  else
+  {
+    std::cout << std::setw( 9 ) << "";
+  }
+
+  std::cout << "   (checksum " << checksum << ")\n";
+  return seconds;
+}
+
+template <typename Kernel>
+double bench_oriented_side( char const* name, std::vector<Point2> const& p, unsigned repeats, double baseline = 0.0 )
+{
+  std::clock_t start = std::clock();
+  long checksum = 0;
+
+  for ( unsigned r = 0; r < repeats; ++r )
+  {
+    for ( std::size_t i = 0; i + 2 < p.size(); ++i )
+    {
+      checksum += Kernel::oriented_side( p[i], p[i + 1], p[i + 2] );
+    }
+  }
+
+  return report( name, seconds_since( start ), repeats * ( p.size() - 2 ), checksum, baseline );
+}
+
+template <typename Kernel>
+double bench_oriented_circle( char const* name, std::vector<Point2> const& p, unsigned repeats, double baseline = 0.0 )
+{
+  std::clock_t start = std::clock();
+  long checksum = 0;
+
+  for ( unsigned r = 0; r < repeats; ++r )
+  {
+    for ( std::size_t i = 0; i + 3 < p.size(); ++i )
+    {
+      checksum += Kernel::oriented_circle( p[i], p[i + 1], p[i + 2], p[i + 3] );
+    }
+  }
+
+  return report( name, seconds_since( start ), repeats * ( p.size() - 3 ), checksum, baseline );
+}
+
+// Triangulates and refines the polygon repeatedly and reports the median
+// time; the number of queries is that of the faces of the mesh and the
+// checksum that of the nodes.
+template <typename Kernel>
+double bench_mesh( char const* name, Polygon const& boundary, double max_area, unsigned repeats, double baseline = 0.0 )
+{
+  typedef Delaunay_triangulation< Delaunay_triangulation_items, Kernel > Mesh;
+
+  std::vector<double> times;
+  std::size_t num_faces = 0, num_nodes = 0;
+
+  for ( unsigned r = 0; r < repeats; ++r )
+  {
+    std::clock_t start = std::clock();
+
+    Mesh mesh;
+    Triangulator<Mesh> triangulator;
+    triangulator.triangulate( boundary, mesh );
+    mesh.make_cdt();
+    Delaunay_mesher<Mesh> mesher;
+    mesher.refine( mesh, max_area, 21.0 );
+
+    times.push_back( seconds_since( start ) );
+    num_faces = mesh.number_of_faces();
+    num_nodes = mesh.number_of_nodes();
+  }
+
+  std::nth_element( times.begin(), times.begin() + times.size() / 2, times.end() );
+  return report( name, times[times.size() / 2], num_faces, num_nodes, baseline );
+}
+
+} // namespace
+
+int main( int argc, const char* argv[] )
+{
+  std::size_t num_points;
+  unsigned repeats;
+  unsigned mesh_repeats;
+  double degenerate;
+  double max_area;
+
+  po::options_description po_desc( "Allowed options" );
+  po_desc.add_options()
+    ( "help", "produce help message" )
+    ( "points,n", po::value<std::size_t>( &num_points )->default_value( 1000000 ), "set the number of random points" )
+    ( "repeats,r", po::value<unsigned>( &repeats )->default_value( 10 ), "set the number of passes over the points" )
+    ( "degenerate,d", po::value<double>( &degenerate )->default_value( 0.0 ), "set the fraction of points put on a common line or circle" )
+    ( "max-size,s", po::value<double>( &max_area )->default_value( 0.0001 ), "set the maximum triangle area for meshing the input polygon" )
+    ( "mesh-repeats", po::value<unsigned>( &mesh_repeats )->default_value( 5 ), "set how many times the input polygon is meshed with each kernel (the median time is reported)" )
+    ( "input-file", po::value<std::string>(), "also mesh this polygon (in Well-Known Text format) with each kernel" )
+    ;
+
+  po::positional_options_description po_pdesc;
+  po_pdesc.add( "input-file", -1 );
+
+  po::variables_map po_vm;
+  po::store( po::command_line_parser( argc, argv ).options( po_desc ).positional( po_pdesc ).run(), po_vm );
+  po::notify( po_vm );
+
+  if ( po_vm.count( "help" ) )
+  {
+    std::cout << po_desc << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if ( num_points < 4 )
+  {
+    std::cerr << "At least four points are needed\n";
+    return EXIT_FAILURE;
+  }
+
+  if ( mesh_repeats == 0 )
+  {
+    std::cerr << "The polygon has to be meshed at least once\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<Point2> points = random_points( num_points, degenerate );
+  Semi_static_kernel::set_bounding_box( Bounding_box( Point2( 0.0, 0.0 ), Point2( 1.0, 1.0 ) ) );
+
+  double baseline;
+
+  std::cout << "oriented_side\n";
+  baseline = bench_oriented_side<Exact_adaptive_kernel>( "exact adaptive", points, repeats );
+  bench_oriented_side<Fast_inexact_kernel>( "fast inexact", points, repeats, baseline );
+  bench_oriented_side<Semi_static_kernel>( "semi-static", points, repeats, baseline );
+  bench_oriented_side<Interval_kernel>( "interval", points, repeats, baseline );
+
+  std::cout << "oriented_circle\n";
+  baseline = bench_oriented_circle<Exact_adaptive_kernel>( "exact adaptive", points, repeats );
+  bench_oriented_circle<Fast_inexact_kernel>( "fast inexact", points, repeats, baseline );
+  bench_oriented_circle<Semi_static_kernel>( "semi-static", points, repeats, baseline );
+  bench_oriented_circle<Interval_kernel>( "interval", points, repeats, baseline );
+
+  if ( po_vm.count( "input-file" ) )
+  {
+    Polygon boundary;
+    read_polygon( po_vm["input-file"].as< std::string >(), boundary );
+
+    Bounding_box box;
+    boost::geometry::envelope( boundary, box );
+    Semi_static_kernel::set_bounding_box( box );
+    Integer_grid_kernel::set_bounding_box( box );
+
+    std::cout << "meshing (median of " << mesh_repeats << " runs, time per face, nodes as checksum)\n";
+    baseline = bench_mesh<Exact_adaptive_kernel>( "exact adaptive", boundary, max_area, mesh_repeats );
+    bench_mesh<Fast_inexact_kernel>( "fast inexact", boundary, max_area, mesh_repeats, baseline );
+    bench_mesh<Semi_static_kernel>( "semi-static", boundary, max_area, mesh_repeats, baseline );
+    bench_mesh<Interval_kernel>( "interval", boundary, max_area, mesh_repeats, baseline );
+    bench_mesh<Integer_grid_kernel>( "integer grid", boundary, max_area, mesh_repeats, baseline );
+  }
+
+  return EXIT_SUCCESS;
+}
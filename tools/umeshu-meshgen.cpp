@@ -22,9 +22,18 @@
 #include <umeshu/Delaunay_mesher.h>
 #include <umeshu/Delaunay_triangulation.h>
 #include <umeshu/Delaunay_triangulation_items.h>
+#include <umeshu/Domain_decomposition_mesher.h>
 #include <umeshu/Exceptions.h>
+#include <umeshu/Fast_inexact_kernel.h>
+#include <umeshu/Integer_grid_kernel.h>
+#include <umeshu/Interval_kernel.h>
 #include <umeshu/Polygon.h>
+#include <umeshu/Predicate_stats.h>
+#include <umeshu/Quad_dominant_mesh.h>
 #include <umeshu/Relaxer.h>
+#include <umeshu/Semi_static_kernel.h>
+#include <umeshu/Sizing.h>
+#include <umeshu/Smoother.h>
 #include <umeshu/Triangulator.h>
 #include <umeshu/io/OBJ.h>
 #include <umeshu/io/OFF.h>
@@ -32,29 +41,222 @@
 #include <umeshu/io/EPS.h>
 #include <umeshu/io/STL.h>
 
+#include <boost/geometry/algorithms/envelope.hpp>
 #include <boost/program_options.hpp>
 
+#include <iomanip>
+#include <iostream>
+
 using namespace umeshu;
 namespace po = boost::program_options;
 
-typedef Delaunay_triangulation< Delaunay_triangulation_items_with_id > Mesh;
-typedef Mesh::Node_handle     Node_handle;
-typedef Mesh::Halfedge_handle Halfedge_handle;
-typedef Mesh::Edge_handle     Edge_handle;
-typedef Mesh::Face_handle     Face_handle;
-typedef Delaunay_mesher< Mesh > Mesher;
-typedef Relaxer< Mesh >       Relax;
-
-int main( int argc, const char* argv[] )
+struct Options
 {
   double max_area;
   double min_angle;
+  unsigned num_threads;
+  unsigned num_subdomains;
+  double gradation;
+  unsigned num_levels;
+  std::size_t num_faces;
+  double time_limit;
+  std::size_t node_limit;
+  double memory_limit;
+  bool coarsen;
+  unsigned num_sweeps;
+  std::string smoothing;
+  std::string quads;
+};
+
+template <typename Kernel>
+void generate( Polygon const& boundary, Options const& options )
+{
+  typedef Delaunay_triangulation< Delaunay_triangulation_items_with_id, Kernel > Mesh;
+  typedef Delaunay_mesher< Mesh > Mesher;
+  typedef Relaxer< Mesh >         Relax;
+  typedef Smoother< Mesh >        Smooth;
+
+  Mesh mesh;
+
+  if ( options.num_subdomains > 1 )
+  {
+    Domain_decomposition_mesher<Mesh> dd_mesher;
+    dd_mesher.set_num_subdomains( options.num_subdomains );
+    dd_mesher.set_num_threads( options.num_threads );
+    dd_mesher.mesh( boundary, mesh, options.max_area, options.min_angle );
+  }
+  else
+  {
+    Triangulator<Mesh> triangulator;
+    triangulator.triangulate( boundary, mesh );
+    io::write_eps( "mesh_1.eps", mesh );
+
+    mesh.make_cdt();
+    io::write_eps( "mesh_2.eps", mesh );
+
+    Mesher mesher;
+    mesher.set_num_threads( options.num_threads );
+    typename Mesher::Limits limits;
+    limits.seconds = options.time_limit;
+    limits.num_nodes = options.node_limit;
+    limits.num_bytes = static_cast<std::size_t>( options.memory_limit * 1024 * 1024 );
+    mesher.set_limits( limits );
+
+    if ( options.gradation > 0 )
+    {
+      Mesh input;
+      triangulator.triangulate( boundary, input );
+      input.make_cdt();
+      mesher.refine( mesh, options.max_area, options.min_angle, Local_feature_size<Mesh>( input, options.gradation ) );
+    }
+    else if ( options.num_faces > 0 )
+    {
+      double area = mesher.refine_to_count( mesh, options.num_faces, options.min_angle );
+      std::cout << "Maximum triangle area reached: " << area << std::endl;
+    }
+    else if ( options.num_levels > 1 )
+    {
+      Mesh_hierarchy<Mesh> hierarchy;
+      mesher.refine_levels( mesh, options.max_area, options.min_angle, options.num_levels, hierarchy );
+
+      for ( std::size_t level = 0; level < hierarchy.number_of_levels(); ++level )
+      {
+        std::cout << "Level " << level << ": "
+          << hierarchy.number_of_nodes( level ) << " nodes, "
+          << hierarchy.number_of_faces( level ) << " faces" << std::endl;
+      }
+    }
+    else
+    {
+      mesher.refine( mesh, options.max_area, options.min_angle );
+    }
+
+    typename Mesher::Report const& report = mesher.report();
+
+    if ( report.limit != Mesher::NO_LIMIT )
+    {
+      static char const* const limit_names[] = { "", "time", "node", "memory" };
+      std::cout << "Refinement stopped by the " << limit_names[report.limit] << " limit with "
+        << report.num_bad_faces << " bad triangles (" << report.num_large_faces << " too large, "
+        << report.num_skinny_faces << " too skinny) and " << report.num_encroached_edges
+        << " encroached boundary edges" << std::endl;
+    }
+  }
+  io::write_eps( "mesh_3.eps", mesh );
+  io::write_stl( "mesh_3.stl", mesh );
+  io::write_off( "mesh_3.off", mesh );
+  io::write_obj( "mesh_3.obj", mesh );
+  io::write_ply( "mesh_3.ply", mesh );
+
+  // Smoothing restores the Delaunay property by flips, which would undo
+  // the degree-improving flips of the relaxation, so it goes first.
+  if ( options.num_sweeps > 0 )
+  {
+    Smooth smooth;
+
+    if ( options.smoothing == "laplacian" )
+    {
+      smooth.set_method( Smooth::LAPLACIAN );
+    }
+    else if ( options.smoothing == "cvt" )
+    {
+      smooth.set_method( Smooth::CVT );
+    }
+
+    smooth.set_num_threads( options.num_threads );
+    smooth.smooth( mesh, options.num_sweeps );
+    std::cout << "Smoothing moves undone: " << smooth.number_of_rollbacks() << std::endl;
+    io::write_eps( "mesh_4.eps", mesh );
+  }
+
+  Relax relax;
+  relax.set_num_threads( options.num_threads );
+  relax.relax( mesh );
+
+  if ( options.coarsen )
+  {
+    std::cout << "Collapsed edges: " << relax.coarsen( mesh ) << std::endl;
+  }
+
+  io::write_eps( "mesh_5.eps", mesh );
+
+  std::cout << "Final mesh:" << std::endl
+    << "  # nodes: " << mesh.number_of_nodes() << std::endl
+    << "  # edges: " << mesh.number_of_edges() << std::endl
+    << "  # faces: " << mesh.number_of_faces() << std::endl;
+
+  if ( options.quads != "none" )
+  {
+    Quad_dominant_mesh<Mesh> quad_mesh;
+    quad_mesh.pair_triangles( mesh );
+
+    if ( options.quads == "all" )
+    {
+      quad_mesh.split_into_quads();
+    }
+
+    io::write_off( "mesh_6.off", quad_mesh );
+    io::write_obj( "mesh_6.obj", quad_mesh );
+    io::write_ply( "mesh_6.ply", quad_mesh );
+
+    std::cout << "Quadrilateral mesh:" << std::endl
+      << "  # nodes: " << quad_mesh.number_of_nodes() << std::endl
+      << "  # quadrilaterals: " << quad_mesh.number_of_quads() << std::endl
+      << "  # triangles: " << quad_mesh.number_of_triangles() << std::endl;
+  }
+}
+
+void print_predicate_counts( char const* name, Predicate_counts const& counts )
+{
+  double percent = counts.calls > 0 ? 100.0 / counts.calls : 0.0;
+  std::cout << "  " << name << ": " << counts.calls << " calls" << std::endl
+    << std::fixed << std::setprecision( 4 )
+    << "    decided by the filter: " << counts.filtered() << " (" << percent * counts.filtered() << " %)" << std::endl
+    << "    reached stage B: " << counts.stage_b << " (" << percent * counts.stage_b << " %)" << std::endl
+    << "    reached stage C: " << counts.stage_c << " (" << percent * counts.stage_c << " %)" << std::endl
+    << "    reached the exact stage: " << counts.exact << " (" << percent * counts.exact << " %)" << std::endl;
+  std::cout.unsetf( std::ios::floatfield );
+}
+
+void print_predicate_stats()
+{
+  if ( ! predicate_stats_enabled() )
+  {
+    std::cout << "Predicate statistics not available, build with UMESHU_PREDICATE_STATS enabled" << std::endl;
+    return;
+  }
+
+  Predicate_stats stats = predicate_stats();
+  std::cout << "Predicate statistics:" << std::endl;
+  print_predicate_counts( "orient2d", stats.orient2d );
+  print_predicate_counts( "incircle", stats.incircle );
+}
+
+int main( int argc, const char* argv[] )
+{
+  Options options;
+  std::string kernel;
+  bool stats;
 
   po::options_description po_desc( "Allowed options" );
   po_desc.add_options()
     ( "help", "produce help message" )
-    ( "max-size,s", po::value<double>( &max_area )->default_value( 0.01 ), "set the maximum triangle area for the refinement algorithm" )
-    ( "min-angle,a", po::value<double>( &min_angle )->default_value( 21 ), "set the minimum angle for the refinement algorithm" )
+    ( "max-size,s", po::value<double>( &options.max_area )->default_value( 0.01 ), "set the maximum triangle area for the refinement algorithm" )
+    ( "min-angle,a", po::value<double>( &options.min_angle )->default_value( 21 ), "set the minimum angle for the refinement algorithm" )
+    ( "threads,j", po::value<unsigned>( &options.num_threads )->default_value( 1 ), "set the number of threads used by the refinement algorithm (experimental: only the cavity search runs in parallel)" )
+    ( "subdomains,d", po::value<unsigned>( &options.num_subdomains )->default_value( 1 ), "mesh the domain cut into this many strips independently" )
+    ( "gradation,g", po::value<double>( &options.gradation )->default_value( 0 ), "grade the mesh by the local feature size of the input growing at this rate (0 to disable)" )
+    ( "levels,l", po::value<unsigned>( &options.num_levels )->default_value( 1 ), "refine in this many levels, dividing the maximum area by four at each" )
+    ( "faces,n", po::value<std::size_t>( &options.num_faces )->default_value( 0 ), "refine to about this many triangles instead of by the maximum area (0 to disable)" )
+    ( "time-limit", po::value<double>( &options.time_limit )->default_value( 0 ), "stop the refinement after this many seconds (0 for no limit)" )
+    ( "node-limit", po::value<std::size_t>( &options.node_limit )->default_value( 0 ), "stop the refinement at this many nodes (0 for no limit)" )
+    ( "memory-limit", po::value<double>( &options.memory_limit )->default_value( 0 ), "stop the refinement when the mesh takes this many megabytes (0 for no limit)" )
+    ( "coarsen", po::bool_switch( &options.coarsen ), "collapse the edges between pairs of interior nodes of degree five after the relaxation" )
+    ( "smooth", po::value<unsigned>( &options.num_sweeps )->default_value( 0 ), "smooth the mesh by this many sweeps before the relaxation" )
+    ( "smoothing", po::value<std::string>( &options.smoothing )->default_value( "odt" ), "set the smoothing method: laplacian, odt or cvt" )
+    ( "quads", po::value<std::string>( &options.quads )->default_value( "none" ), "pair the triangles of the final mesh into quadrilaterals: none, dominant or all (split into quadrilaterals only)" )
+    ( "kernel,k", po::value<std::string>( &kernel )->default_value( "exact" ), "set the geometric kernel: exact, fast (inexact), semi-static, interval or integer" )
+    ( "stats", po::bool_switch( &stats ), "report how many predicate calls were decided by the floating-point filter and how many reached the adaptive and exact stages" )
     ( "input-file", po::value<std::string>(), "input file describing the polygonal boundary (in Well-Known Text format)");
 
   po::positional_options_description po_pdesc;
@@ -77,54 +279,93 @@ int main( int argc, const char* argv[] )
     return EXIT_FAILURE;
   }
 
-  std::cout << "Parameters used:" << std::endl
-    << "  maximum triangle area = " << max_area << std::endl
-    << "  minimum angle = " << min_angle << std::endl;
+  if ( options.smoothing != "laplacian" && options.smoothing != "odt" && options.smoothing != "cvt" )
+  {
+    std::cout << "Unknown smoothing method: " << options.smoothing << "\n";
+    std::cout << po_desc << std::endl;
+    return EXIT_FAILURE;
+  }
 
-  try
+  if ( options.quads != "none" && options.quads != "dominant" && options.quads != "all" )
   {
-    Polygon boundary;
-    read_polygon( po_vm["input-file"].as< std::string >(), boundary );
+    std::cout << "Unknown quadrilateral conversion: " << options.quads << "\n";
+    std::cout << po_desc << std::endl;
+    return EXIT_FAILURE;
+  }
 
-    Mesh mesh;
+  if ( kernel != "exact" && kernel != "fast" && kernel != "semi-static" && kernel != "interval" && kernel != "integer" )
+  {
+    std::cout << "Unknown kernel: " << kernel << "\n";
+    std::cout << po_desc << std::endl;
+    return EXIT_FAILURE;
+  }
 
-    Triangulator<Mesh> triangulator;
-    triangulator.triangulate( boundary, mesh );
-    io::write_eps( "mesh_1.eps", mesh );
+  int num_modes = ( options.num_subdomains > 1 ) + ( options.gradation > 0 ) + ( options.num_faces > 0 ) + ( options.num_levels > 1 );
 
-    mesh.make_cdt();
-    io::write_eps( "mesh_2.eps", mesh );
+  if ( num_modes > 1 )
+  {
+    std::cout << "Conflicting options: only one of --subdomains, --gradation, --faces and --levels can be used\n";
+    std::cout << po_desc << std::endl;
+    return EXIT_FAILURE;
+  }
 
-    Mesher mesher;
-    mesher.refine( mesh, max_area, min_angle );
-    io::write_eps( "mesh_3.eps", mesh );
-    io::write_stl( "mesh_3.stl", mesh );
-    io::write_off( "mesh_3.off", mesh );
-    io::write_obj( "mesh_3.obj", mesh );
-    io::write_ply( "mesh_3.ply", mesh );
-
-    Relax relax;
-    relax.relax( mesh );
-    io::write_eps( "mesh_4.eps", mesh );
+  bool has_limits = options.time_limit > 0 || options.node_limit > 0 || options.memory_limit > 0;
 
-    // smoother smooth;
-    // smooth.smooth(m, 1);
-    // Postscript_stream ps5("mesh_5.eps", m.bounding_box());
-    // ps5 << m;
+  if ( options.num_subdomains > 1 && has_limits )
+  {
+    std::cout << "Conflicting options: --time-limit, --node-limit and --memory-limit cannot be used with --subdomains\n";
+    std::cout << po_desc << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Parameters used:" << std::endl
+    << "  maximum triangle area = " << options.max_area << std::endl
+    << "  minimum angle = " << options.min_angle << std::endl
+    << "  number of threads = " << options.num_threads << std::endl
+    << "  number of subdomains = " << options.num_subdomains << std::endl
+    << "  gradation = " << options.gradation << std::endl
+    << "  number of levels = " << options.num_levels << std::endl
+    << "  target number of triangles = " << options.num_faces << std::endl
+    << "  coarsen = " << ( options.coarsen ? "yes" : "no" ) << std::endl
+    << "  smoothing sweeps = " << options.num_sweeps << " (" << options.smoothing << ")" << std::endl
+    << "  quadrilaterals = " << options.quads << std::endl
+    << "  kernel = " << kernel << std::endl;
+
+  try
+  {
+    Polygon boundary;
+    read_polygon( po_vm["input-file"].as< std::string >(), boundary );
 
-    // // code does not pass a debug assert:
-    // meshgen.refine(0.0001000, 25);
-    // Postscript_stream ps6("mesh_6.eps", m.bounding_box());
-    // ps6 << m;
+    Bounding_box box;
+    boost::geometry::envelope( boundary, box );
 
-    // // smooth.smooth(m, 5);
-    // // Postscript_stream ps7("mesh_7.eps", m.bounding_box());
-    // // ps7 << m;
+    if ( kernel == "exact" )
+    {
+      generate<Exact_adaptive_kernel>( boundary, options );
+    }
+    else if ( kernel == "fast" )
+    {
+      generate<Fast_inexact_kernel>( boundary, options );
+    }
+    else if ( kernel == "semi-static" )
+    {
+      Semi_static_kernel::set_bounding_box( box );
+      generate<Semi_static_kernel>( boundary, options );
+    }
+    else if ( kernel == "interval" )
+    {
+      generate<Interval_kernel>( boundary, options );
+    }
+    else
+    {
+      Integer_grid_kernel::set_bounding_box( box );
+      generate<Integer_grid_kernel>( boundary, options );
+    }
 
-    std::cout << "Final mesh:" << std::endl
-      << "  # nodes: " << mesh.number_of_nodes() << std::endl
-      << "  # edges: " << mesh.number_of_edges() << std::endl
-      << "  # faces: " << mesh.number_of_faces() << std::endl;
+    if ( stats )
+    {
+      print_predicate_stats();
+    }
   }
   catch ( boost::exception& e )
   {